@@ -17,53 +17,126 @@
 #include "Neural-Network-v1-NN.h"
 
 
+/**
+ * @details Takes count elements of size bytes from the arena at *offset, rounded up to LAYER_ALIGN.
+ * With base 0 only the offset advances, so the same walk both sizes and places the arrays.
+ */
+
+static void *carve(char *base, size_t *offset, size_t count, size_t size)
+{
+    void *p = base ? base + *offset : 0;
+    *offset += (count * size + LAYER_ALIGN - 1) / LAYER_ALIGN * LAYER_ALIGN;
+    return p;
+}
+
+
+/**
+ * @details Lays out every array of a layer with Gl's sizes in the arena at base, right after the struct.
+ * Returns the bytes used past base.
+ */
+
+static size_t placeLayer(GeneralLayer *Gl, char *base)
+{
+    const size_t H = Gl->hidden_units, S = Gl->hidden_stride, O = NUMBER_OF_OUTPUT_CELLS;
+    size_t offset = (sizeof(GeneralLayer) + LAYER_ALIGN - 1) / LAYER_ALIGN * LAYER_ALIGN;
+
+    Gl->input = carve(base, &offset, NUMBER_OF_INPUT_CELLS, sizeof(double));
+    Gl->input_bits = carve(base, &offset, INPUT_WORDS, sizeof(uint64_t));
+    Gl->active = carve(base, &offset, NUMBER_OF_INPUT_CELLS, sizeof(uint16_t));
+
+    HiddenLayer *h = &Gl->hidden_layer;
+    h->weight = carve(base, &offset, H * NUMBER_OF_INPUT_CELLS, sizeof(double));
+    h->dWeight1 = carve(base, &offset, H * NUMBER_OF_INPUT_CELLS, sizeof(double));
+    h->bias = carve(base, &offset, H, sizeof(double));
+    h->dbias1 = carve(base, &offset, H, sizeof(double));
+    h->z1 = carve(base, &offset, H, sizeof(double));
+    h->a1 = carve(base, &offset, H, sizeof(double));
+    h->dz1 = carve(base, &offset, H, sizeof(double));
+    h->da1 = carve(base, &offset, H, sizeof(double));
+
+    OutputLayer *out = &Gl->output_layer;
+    out->weight = carve(base, &offset, O * S, sizeof(double));
+    out->dWeight2 = carve(base, &offset, O * S, sizeof(double));
+    out->bias = carve(base, &offset, O, sizeof(double));
+    out->dbias2 = carve(base, &offset, O, sizeof(double));
+    out->z2 = carve(base, &offset, O, sizeof(double));
+    out->a2 = carve(base, &offset, O, sizeof(double));
+    out->dz2 = carve(base, &offset, O, sizeof(double));
+    out->da2 = carve(base, &offset, O, sizeof(double));
+
+    return offset;
+}
+
+
+/**
+ * @details Allocates a layer of hiddenUnits hidden units as one arena, aligned to LAYER_ALIGN,
+ * with the struct at its start and every array zeroed. Returns 0 on failure.
+ */
+
+GeneralLayer *createLayer(int hiddenUnits, double learningRate)
+{
+    if (hiddenUnits < 1 || (size_t)hiddenUnits > ((size_t)-1 / 4) / (NUMBER_OF_INPUT_CELLS * sizeof(double))) return 0;
+
+    GeneralLayer shape;
+    memset(&shape, 0, sizeof(shape));
+    shape.hidden_units = hiddenUnits;
+    shape.hidden_stride = (hiddenUnits + LAYER_ALIGN/sizeof(double) - 1) / (LAYER_ALIGN/sizeof(double)) * (LAYER_ALIGN/sizeof(double));
+    shape.learning_rate = learningRate;
+    shape.arena_size = placeLayer(&shape, 0);
+
+    char *raw = malloc(shape.arena_size + LAYER_ALIGN);
+    if (!raw) return 0;
+
+    /// The byte before the aligned start records how far it is from what malloc returned.
+    char *base = (char *)(((uintptr_t)raw + LAYER_ALIGN) & ~(uintptr_t)(LAYER_ALIGN - 1));
+    base[-1] = (char)(base - raw);
 
+    memset(base, 0, shape.arena_size);
+    GeneralLayer *Gl = (GeneralLayer *)base;
+    *Gl = shape;
+    placeLayer(Gl, base);
+
+    return Gl;
+}
 
 
+void freeLayer(GeneralLayer *Gl)
+{
+    if (!Gl) return;
+    char *base = (char *)Gl;
+    free(base - (unsigned char)base[-1]);
+}
+
 
 
 /**
- * @details Initialize layer by setting all weights to random values [0-1] and the inputs to zeros.
+ * @details Initialize layer by setting all weights to random values [0-1] and everything else to zeros.
  */
 
 void initLayer(GeneralLayer *Gl){
 
-    /// initialization of Hidden layer cells.
+    char *arrays = (char *)Gl->input;
+    memset(arrays, 0, (char *)Gl + Gl->arena_size - arrays);
+
+    /// initialization of Hidden layer weights, one row per hidden unit.
         int o;
-    for ( o=0; o<HIDDEN_UNITS; o++){
+    for ( o=0; o<Gl->hidden_units; o++){
+        double *w = Gl->hidden_layer.weight + (size_t)o*NUMBER_OF_INPUT_CELLS;
         int i;
         for (i=0; i<NUMBER_OF_INPUT_CELLS; i++){
 
-            Gl->hidden_layer.cell[o].input[i]=0;
-            Gl->hidden_layer.cell[o].weight[i]=rand()/(double)(RAND_MAX);
-            Gl->hidden_layer.cell[o].dWeight1[i]=0;
+            w[i]=rand()/(double)(RAND_MAX);
 
         }
-
-        Gl->hidden_layer.cell[o].bias = 0;
-        Gl->hidden_layer.cell[o].dbias1=0;
-        Gl->hidden_layer.cell[o].z1=0;
-        Gl->hidden_layer.cell[o].a1=0;
-        Gl->hidden_layer.cell[o].dz1=0;
-        Gl->hidden_layer.cell[o].da1=0;
     }
 
-    /// initialization of Output layer cells.
+    /// initialization of Output layer weights.
     for ( o=0; o<NUMBER_OF_OUTPUT_CELLS; o++){
+        double *w = Gl->output_layer.weight + (size_t)o*Gl->hidden_stride;
         int i;
-        for (i=0; i<HIDDEN_UNITS; i++){
-            Gl->output_layer.cell[o].input[i]=0;
-            Gl->output_layer.cell[o].weight[i]=rand()/(double)(RAND_MAX);
-            Gl->output_layer.cell[o].dWeight2[i]=0;
+        for (i=0; i<Gl->hidden_units; i++){
+            w[i]=rand()/(double)(RAND_MAX);
         }
-
-
-        Gl->output_layer.cell[o].bias = 0;
-        Gl->output_layer.cell[o].dbias2=0;
-        Gl->output_layer.cell[o].z2=0;
-        Gl->output_layer.cell[o].a2=0;
-        Gl->output_layer.cell[o].dz2=0;
-        Gl->output_layer.cell[o].da2=0;
     }
 
 }
@@ -72,20 +145,10 @@ void initLayer(GeneralLayer *Gl){
 
 void resetLayer(GeneralLayer *Gl)
 {
-         int o;
-    for ( o=0; o<HIDDEN_UNITS; o++)
-        {
-
-        Gl->hidden_layer.cell[o].z1=0;
-        Gl->hidden_layer.cell[o].a1=0;
-        }
-
-    for ( o=0; o<NUMBER_OF_OUTPUT_CELLS; o++)
-        {
-
-        Gl->output_layer.cell[o].z2=0;
-        Gl->output_layer.cell[o].a2=0;
-        }
+    memset(Gl->hidden_layer.z1, 0, Gl->hidden_units*sizeof(double));
+    memset(Gl->hidden_layer.a1, 0, Gl->hidden_units*sizeof(double));
+    memset(Gl->output_layer.z2, 0, NUMBER_OF_OUTPUT_CELLS*sizeof(double));
+    memset(Gl->output_layer.a2, 0, NUMBER_OF_OUTPUT_CELLS*sizeof(double));
 }
 
 /**
@@ -93,78 +156,143 @@ void resetLayer(GeneralLayer *Gl)
  * of a given MNIST image, setting input vector cells to [0,1]
  * based on the pixels of the image.
  * Scalar pixel intensity [=grey-scale] is ignored, only 0 or 1 [=black-white].
+ * The vector is shared by all hidden units, so the image is copied once.
+ * With BINARY_INPUT the pixels are packed into input_bits instead.
+ * Also lists the ink pixels in active, for SPARSE_GRADIENT.
  */
 
 void setCellInput(GeneralLayer *Gl, MNIST_Image *img)
 {
-        int o;
-    for ( o=0; o<HIDDEN_UNITS; o++){
         int i;
-        for (i=0; i<NUMBER_OF_INPUT_CELLS; i++){
-        Gl->hidden_layer.cell[o].input[i] = img->pixel[i] ? 1 : 0;
+    Gl->active_count = 0;
+#if BINARY_INPUT
+    memset(Gl->input_bits, 0, INPUT_WORDS*sizeof(uint64_t));
+#endif
+    for (i=0; i<NUMBER_OF_INPUT_CELLS; i++){
+#if BINARY_INPUT
+        if (img->pixel[i]) Gl->input_bits[i/64] |= (uint64_t)1 << (i%64);
+#else
+        Gl->input[i] = img->pixel[i] ? 1 : 0;
+#endif
+        if (img->pixel[i]) Gl->active[Gl->active_count++] = i;
+    }
+}
+
+
+#if BINARY_INPUT
+/**
+ * @details Sum of w[i] over the set bits i of the packed input, in increasing order of i,
+ * so it equals the dense 0/1 dot product exactly. No multiplications.
+ */
+
+static double sum_Set_Bits(uint64_t const *bits, double const *w)
+{
+    double sum = 0;
+    int j;
+    for (j=0; j<INPUT_WORDS; j++)
+    {
+        uint64_t b = bits[j];
+        double const *wj = w + j*64;
+        while (b)
+        {
+            sum += wj[__builtin_ctzll(b)];
+            b &= b - 1;
+        }
     }
+    return sum;
 }
+#endif
+
+
+#if BINARY_INPUT && !SPARSE_GRADIENT
+/**
+ * @details dw[i] = dz for the set bits i of the packed input, 0 elsewhere.
+ */
+
+static void scatter_Set_Bits(uint64_t const *bits, double dz, double *dw)
+{
+    memset(dw, 0, NUMBER_OF_INPUT_CELLS*sizeof(double));
+    int j;
+    for (j=0; j<INPUT_WORDS; j++)
+    {
+        uint64_t b = bits[j];
+        double *dwj = dw + j*64;
+        while (b)
+        {
+            dwj[__builtin_ctzll(b)] = dz;
+            b &= b - 1;
+        }
+    }
 }
+#endif
 
 
 
 
 /**
- * @details  forward propagation for hidden layer.
+ * @details  forward propagation for hidden layer: z1 = W1 * input + b1, a single matrix-vector product.
+ * With BINARY_INPUT each row only sums the weights of the ink pixels.
  */
 
 void forward_Hidden_cell(GeneralLayer *Gl)
 {
-
      int o;
-    for ( o=0; o<HIDDEN_UNITS; o++)
+    for ( o=0; o<Gl->hidden_units; o++)
     {
+        double const *w = Gl->hidden_layer.weight + (size_t)o*NUMBER_OF_INPUT_CELLS;
+#if BINARY_INPUT
+        const double sum = sum_Set_Bits(Gl->input_bits, w);
+#else
+        double const *x = Gl->input;
+        double sum = 0;
 
         int i;
         for (i=0; i<NUMBER_OF_INPUT_CELLS; i++)
         {
-        Gl->hidden_layer.cell[o].z1+=Gl->hidden_layer.cell[o].input[i] * Gl->hidden_layer.cell[o].weight[i];
+        sum += x[i] * w[i];
         }
+#endif
 
-        Gl->hidden_layer.cell[o].z1+=Gl->hidden_layer.cell[o].bias;
-
-        Gl->hidden_layer.cell[o].a1=tanh(Gl->hidden_layer.cell[o].z1); /// "tanh" as activation function for hidden units.
-
-    //printf(" z1 is: %lf \n",Gl->hidden_layer.cell[o].z1) ;                                                                         /// to make the output between [0-1].
-   // printf(" a1 is: %lf \n",Gl->hidden_layer.cell[o].a1) ;
-
+        Gl->hidden_layer.z1[o] = sum + Gl->hidden_layer.bias[o];
 
+        Gl->hidden_layer.a1[o]=tanh(Gl->hidden_layer.z1[o]); /// "tanh" as activation function for hidden units.
 
     }
 }
 
 /**
- * @details
+ * @details forward propagation for output layer: z2 = W2 * a1 + b2.
  */
 
 void forward_Output_cell(GeneralLayer *Gl)
 {
+    double const *x = Gl->hidden_layer.a1;
+
     int o;
     for ( o=0; o<NUMBER_OF_OUTPUT_CELLS; o++)
 {
+        double const *w = Gl->output_layer.weight + (size_t)o*Gl->hidden_stride;
+        double sum = 0;
+
         int i;
-        for (i=0; i<HIDDEN_UNITS; i++)
+        for (i=0; i<Gl->hidden_units; i++)
         {
-        Gl->output_layer.cell[o].z2+=Gl->hidden_layer.cell[i].a1 * Gl->output_layer.cell[o].weight[i];
+        sum += x[i] * w[i];
 
         }
 
-        Gl->output_layer.cell[o].z2+=Gl->output_layer.cell[o].bias;
+        Gl->output_layer.z2[o] = sum + Gl->output_layer.bias[o];
 
-        Gl->output_layer.cell[o].a2= 1/(1+exp(-(Gl->output_layer.cell[o].z2))); /// sigmoid function as activation function
+        Gl->output_layer.a2[o]= 1/(1+exp(-(Gl->output_layer.z2[o]))); /// sigmoid function as activation function
 
-        //printf(" z2 is: %lf \n",Gl->output_layer.cell[o].z2) ;                                                                         /// to make the output between [0-1].
-        printf(" a2 is: %lf \n",Gl->output_layer.cell[o].a2) ;
+        printf(" a2 is: %lf \n",Gl->output_layer.a2[o]) ;
 }
 
 
 }
 
+
+
 /**
  * @details
  */
@@ -183,14 +311,14 @@ void Forward_Propagation(GeneralLayer *Gl ,MNIST_Image *img)
 
 double Cost_Function(GeneralLayer *Gl,Vector *target)
 {
-    double cost;
+    double cost=0;
     int o;
     for ( o=0; o<NUMBER_OF_OUTPUT_CELLS; o++)
         {
             //printf("target is: %d \n\n",target->val[o]);
-            //printf("a2: %lf \n\n",Gl->output_layer.cell[o].a2);
-            cost+= -( ( target->val[o]*log(Gl->output_layer.cell[o].a2)) + ((1-target->val[o])*log(1-(Gl->output_layer.cell[o].a2))));
-            //cost+=pow( (target->val[o]- Gl->output_layer.cell[o].a2) ,2);
+            //printf("a2: %lf \n\n",Gl->output_layer.a2[o]);
+            cost+= -( ( target->val[o]*log(Gl->output_layer.a2[o])) + ((1-target->val[o])*log(1-(Gl->output_layer.a2[o]))));
+            //cost+=pow( (target->val[o]- Gl->output_layer.a2[o]) ,2);
 
 
         }
@@ -206,86 +334,94 @@ double Cost_Function(GeneralLayer *Gl,Vector *target)
 
 void Backward_Propagation(GeneralLayer *Gl,Vector *target)
 {
+    HiddenLayer *h = &Gl->hidden_layer;
+    OutputLayer *out = &Gl->output_layer;
+
 /// ##################  calculate dz2,dw2,db2   ######################.
 
-/// dz2
+/// dz2, db2
     int o;
     for ( o=0; o<NUMBER_OF_OUTPUT_CELLS; o++)
         {
-            Gl->output_layer.cell[o].dz2=Gl->output_layer.cell[o].a2 - target->val[o];
-           // printf(" dz2 %lf \n",Gl->output_layer.cell[o].dz2);
+            out->dz2[o]=out->a2[o] - target->val[o];
+            out->dbias2[o]=out->dz2[o];
         }
 
-/// dw2
+/// dw2 = dz2 * a1^T
+    const int H = Gl->hidden_units;
+    const size_t S = Gl->hidden_stride;
+
     for ( o=0; o<NUMBER_OF_OUTPUT_CELLS; o++)
         {
+            double *dw = out->dWeight2 + o*S;
 
          int i;
-        for (i=0; i<HIDDEN_UNITS; i++)
+        for (i=0; i<H; i++)
         {
 
-            Gl->output_layer.cell[o].dWeight2[i]=Gl->hidden_layer.cell[i].a1 * Gl->output_layer.cell[o].dz2;
+            dw[i]=h->a1[i] * out->dz2[o];
 
         }
 
         }
 
-/// db2
-
-
-    for ( o=0; o<NUMBER_OF_OUTPUT_CELLS; o++)
-    {
-        Gl->output_layer.cell[o].dbias2=Gl->output_layer.cell[o].dz2;
-
-    }
-
 /// ##################  calculating dz1,dw1,db1   ######################.
 
 
-/// dz1
-
+/// dz1 = (W2^T * dz2) .* (1 - a1^2), db1
         int n;
-         for ( n=0; o<HIDDEN_UNITS; n++)
+         for ( n=0; n<H; n++)
         {
-            double sum1=0;
-            int o;
+            double sum=0;
         for (o=0; o<NUMBER_OF_OUTPUT_CELLS; o++)
             {
-                double sum2=0;
-                 int m;
-                for(m=0;m<HIDDEN_UNITS;m++)
-                {
-                    sum2+=(Gl->output_layer.cell[o].weight[m])*(Gl->output_layer.cell[o].dz2);
-                }
-                sum1+=sum2;
+                sum+=out->weight[o*S + n] * out->dz2[o];
             }
 
-            Gl->hidden_layer.cell[n].dz1=sum1*(1-pow(Gl->hidden_layer.cell[n].a1,2));
+            h->dz1[n]=sum*(1-h->a1[n]*h->a1[n]);
+            h->dbias1[n]=h->dz1[n];
         }
 
-/// dW1
+/// dW1 = dz1 * input^T; with BINARY_INPUT each row is dz1 on the ink pixels and 0 elsewhere.
+/// With SPARSE_GRADIENT only the columns of the ink pixels are written; the input is 1 there.
+#if SPARSE_GRADIENT
+    uint16_t const *active = Gl->active;
+    const int count = Gl->active_count;
 
-         for ( o=0; o<HIDDEN_UNITS; o++)
+         for ( o=0; o<H; o++)
         {
+            double *dw = h->dWeight1 + (size_t)o*NUMBER_OF_INPUT_CELLS;
+            const double dz = h->dz1[o];
 
-         int i;
-        for (i=0; i<NUMBER_OF_INPUT_CELLS; i++)
+         int k;
+        for (k=0; k<count; k++)
         {
-
-            Gl->hidden_layer.cell[o].dWeight1[i]=Gl->hidden_layer.cell[o].input[i] * Gl->hidden_layer.cell[o].dz1;
+            dw[active[k]]=dz;
         }
 
         }
+#elif BINARY_INPUT
+         for ( o=0; o<H; o++)
+        {
+            scatter_Set_Bits(Gl->input_bits, h->dz1[o], h->dWeight1 + (size_t)o*NUMBER_OF_INPUT_CELLS);
+        }
+#else
+    double const *x = Gl->input;
 
-/// db1
-
+         for ( o=0; o<H; o++)
+        {
+            double *dw = h->dWeight1 + (size_t)o*NUMBER_OF_INPUT_CELLS;
+            const double dz = h->dz1[o];
 
+         int i;
+        for (i=0; i<NUMBER_OF_INPUT_CELLS; i++)
+        {
 
-    for ( o=0; o<HIDDEN_UNITS; o++)
-    {
-        Gl->hidden_layer.cell[o].dbias1=Gl->hidden_layer.cell[o].dz1;
+            dw[i]=x[i] * dz;
+        }
 
-    }
+        }
+#endif
 
 
 }
@@ -294,35 +430,50 @@ void Backward_Propagation(GeneralLayer *Gl,Vector *target)
 
 void Update_Weights(GeneralLayer *Gl)
 {
+    HiddenLayer *h = &Gl->hidden_layer;
+    OutputLayer *out = &Gl->output_layer;
+
+/// update w1, row by row; with SPARSE_GRADIENT only the columns of the ink pixels, the others have a zero gradient.
+    const double rate = Gl->learning_rate;
 
-/// update w1
     int o;
-    for ( o=0; o<HIDDEN_UNITS; o++)
+    for ( o=0; o<Gl->hidden_units; o++)
         {
+            double *w = h->weight + (size_t)o*NUMBER_OF_INPUT_CELLS;
+            double const *dw = h->dWeight1 + (size_t)o*NUMBER_OF_INPUT_CELLS;
+
+#if SPARSE_GRADIENT
+            int k;
+        for (k=0; k<Gl->active_count; k++)
+        {
+            const int i = Gl->active[k];
+            w[i]-=rate*dw[i];
+        }
+#else
             int i;
         for (i=0; i<NUMBER_OF_INPUT_CELLS; i++)
         {
-            Gl->hidden_layer.cell[o].weight[i]=Gl->hidden_layer.cell[o].weight[i]-(LEARNING_RATE*Gl->hidden_layer.cell[o].dWeight1[i]);
-             //printf(" updated weight1 %lf \n",Gl->hidden_layer.cell[o].weight[i]);
+            w[i]-=rate*dw[i];
         }
+#endif
 /// update b1
-         Gl->hidden_layer.cell[o].bias=Gl->hidden_layer.cell[o].bias-(LEARNING_RATE*Gl->hidden_layer.cell[o].dbias1);
-         //printf(" updated bias %lf \n",Gl->hidden_layer.cell[o].bias);
+         h->bias[o]-=rate*h->dbias1[o];
         }
 
 /// update w2
     for ( o=0; o<NUMBER_OF_OUTPUT_CELLS; o++)
         {
+            double *w = out->weight + (size_t)o*Gl->hidden_stride;
+            double const *dw = out->dWeight2 + (size_t)o*Gl->hidden_stride;
+
         int i;
-        for (i=0; i<HIDDEN_UNITS; i++)
+        for (i=0; i<Gl->hidden_units; i++)
         {
-            Gl->output_layer.cell[o].weight[i]=Gl->output_layer.cell[o].weight[i]-(LEARNING_RATE*Gl->output_layer.cell[o].dWeight2[i]);
-            //printf(" updated weight2 %lf \n",Gl->output_layer.cell[o].weight[i]);
+            w[i]-=rate*dw[i];
 
         }
 /// update b2
-         Gl->output_layer.cell[o].bias=Gl->output_layer.cell[o].bias-(LEARNING_RATE*Gl->output_layer.cell[o].dbias2);
-         //printf(" updated bias2 %lf \n",Gl->output_layer.cell[o].bias);
+         out->bias[o]-=rate*out->dbias2[o];
 
         }
 
@@ -338,9 +489,8 @@ int getPrediction(GeneralLayer *Gl){
     for ( i=0; i<NUMBER_OF_OUTPUT_CELLS; i++){
 
 
-   // printf(" Maxout: %lf",Gl->output_layer.cell[i].a2);
-        if (Gl->output_layer.cell[i].a2 > maxOut){
-            maxOut = Gl->output_layer.cell[i].a2;
+        if (Gl->output_layer.a2[i] > maxOut){
+            maxOut = Gl->output_layer.a2[i];
             maxInd = i;
 
         }
@@ -371,6 +521,26 @@ int Prediction(GeneralLayer *Gl,MNIST_Image *img)
 
 
 
+/**
+ * @details Copies only the weights and biases from src to dst, e.g. to keep the parameters of the best iteration.
+ * Both must have the same hidden_units.
+ */
+
+void copy_Weights(GeneralLayer *dst, GeneralLayer const *src)
+{
+    const size_t H = src->hidden_units;
+    memcpy(dst->hidden_layer.weight, src->hidden_layer.weight, H*NUMBER_OF_INPUT_CELLS*sizeof(double));
+    memcpy(dst->hidden_layer.bias, src->hidden_layer.bias, H*sizeof(double));
+    memcpy(dst->output_layer.weight, src->output_layer.weight, NUMBER_OF_OUTPUT_CELLS*src->hidden_stride*sizeof(double));
+    memcpy(dst->output_layer.bias, src->output_layer.bias, NUMBER_OF_OUTPUT_CELLS*sizeof(double));
+}
+
+
+
+
+
+
+
 /**
  * @details Returns an output vector with targetIndex set to 1, all others to 0
  */
@@ -404,9 +574,9 @@ void export_Weights(GeneralLayer *Gl)
  /// export weight1 in hidden cells.
 int o;
 
-for(o=0;o<HIDDEN_UNITS;o++)
+for(o=0;o<Gl->hidden_units;o++)
 {
-char filename[HIDDEN_UNITS];
+char filename[32];
 sprintf(filename, "weights1_cell%d.txt", o);
 
 FILE *f;
@@ -415,7 +585,7 @@ int i;
 for(i=0;i<NUMBER_OF_INPUT_CELLS;i++)
 {
 
-fprintf(f, "%.5g\n",Gl->hidden_layer.cell[o].weight[i]);
+fprintf(f, "%.5g\n",Gl->hidden_layer.weight[(size_t)o*NUMBER_OF_INPUT_CELLS + i]);
 }
 fclose(f);
 }
@@ -429,10 +599,10 @@ char filename_bias1[]="bias1.txt";
 
 FILE *f = fopen(filename_bias1, "w+");
 int i;
-for(i=0;i<HIDDEN_UNITS;i++)
+for(i=0;i<Gl->hidden_units;i++)
 {
 
-fprintf(f, "%.5g\n",Gl->hidden_layer.cell[i].bias);
+fprintf(f, "%.5g\n",Gl->hidden_layer.bias[i]);
 }
 
 fclose(f);
@@ -443,15 +613,15 @@ printf("biases1 have been exported \n\n");
 /// export weight2 in output cells
 for(o=0;o<NUMBER_OF_OUTPUT_CELLS;o++)
 {
-char filename[NUMBER_OF_OUTPUT_CELLS];
+char filename[32];
 sprintf(filename, "weights2_cell%d.txt", o);
 
 FILE *f = fopen(filename, "w+");
 
 int i;
-for(i=0;i<HIDDEN_UNITS;i++)
+for(i=0;i<Gl->hidden_units;i++)
 {
-fprintf(f, "%.5g\n",Gl->output_layer.cell[o].weight[i]);
+fprintf(f, "%.5g\n",Gl->output_layer.weight[(size_t)o*Gl->hidden_stride + i]);
 }
 
 fclose(f);
@@ -468,9 +638,9 @@ char filename_bias2[]="bias2.txt";
 FILE *fbias = fopen(filename_bias2, "w+");
 for(i=0;i<NUMBER_OF_OUTPUT_CELLS;i++)
 {
-fprintf(fbias, "%.5g\n",Gl->output_layer.cell[i].bias);
+fprintf(fbias, "%.5g\n",Gl->output_layer.bias[i]);
 }
-fclose(f);
+fclose(fbias);
 
 printf("biases2 have been exported \n\n");
 
@@ -10,17 +10,28 @@
 
 
 #include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
 
-#define NUMBER_OF_INPUT_CELLS 784   /// use 28*28 input cells (= number of pixels per MNIST image)
+#define NUMBER_OF_INPUT_CELLS 784   /// use 28*28 input cells (= number of pixels per MNIST image), fixed by MNIST_Image.
 #define NUMBER_OF_OUTPUT_CELLS 10   /// use 10 output cells to model 10 digits (0-9)
 
-#define LEARNING_RATE  1      /// Incremental increase for changing connection weights
-#define HIDDEN_UNITS   2           /// set hidden units number.
-#define NUMITERATIONS  1        /// number of iterations.
+#define LEARNING_RATE  1      /// default incremental increase for changing connection weights; set at runtime.
+#define HIDDEN_UNITS   2           /// default hidden units number; set at runtime.
+#define NUMITERATIONS  20       /// default maximum number of iterations; early stopping usually ends training sooner.
+#define VALIDATION_IMAGES  10000 /// last training images, held out to decide when to stop.
+#define PATIENCE  3              /// iterations without improvement before stopping.
+#define MIN_DELTA  1e-4          /// smallest drop of the validation cost that counts as an improvement.
+#define SHUFFLE_SEED  1          /// nonzero seed of the training order, reshuffled every iteration.
+#define BINARY_INPUT  1          /// 1: pack each image into a bitset and sum the weights of set pixels, 0: multiply by the input vector.
+#define SPARSE_GRADIENT  1       /// 1: compute and apply dWeight1 only in the columns of the image's ink pixels, 0: all columns.
+
+#define INPUT_WORDS ((NUMBER_OF_INPUT_CELLS+63)/64)  /// 64-bit words in the packed input.
+
+
+#define LAYER_ALIGN 64  /// every array in the arena starts on a cache line.
 
 
-typedef struct OutputCell OutputCell;
-typedef struct HiddenCell HiddenCell;
 typedef struct OutputLayer OutputLayer;
 typedef struct HiddenLayer HiddenLayer;
 typedef struct GeneralLayer GeneralLayer;
@@ -29,62 +40,62 @@ typedef struct Vector Vector;
 
 
 
-/**
- * @brief Core unit of hidden layer of the neural network.
- */
-
-struct HiddenCell{
-    double input [NUMBER_OF_INPUT_CELLS];
-    double weight[NUMBER_OF_INPUT_CELLS];
-    double bias;
-    double dWeight1[NUMBER_OF_INPUT_CELLS];
-    double dbias1;
-    double z1;
-    double a1;
-    double dz1;
-    double da1;
-};
-
-/**
- * @brief Core unit of output layer of the neural network.
- */
-
-struct OutputCell{
-    double bias;
-    double dbias2;
-    double z2;
-    double a2;
-    double dz2;
-    double da2;
-    double input[HIDDEN_UNITS]; // the size will be dynamically allocated.
-    double weight[HIDDEN_UNITS]; // the size will be dynamically allocated.
-    double dWeight2[HIDDEN_UNITS]; // the size will be dynamically allocated.
-};
-
-
 /**
  * @brief The single hidden layer of this network.
+ * weight and dWeight1 are matrices of one row of NUMBER_OF_INPUT_CELLS per hidden unit;
+ * 784 doubles per row keeps every row aligned.
  */
 
 struct HiddenLayer{
-    HiddenCell cell[HIDDEN_UNITS]; // the size will be dynamically allocated.
+    double *weight;
+    double *dWeight1;
+    double *bias;
+    double *dbias1;
+    double *z1;
+    double *a1;
+    double *dz1;
+    double *da1;
 };
 
 
 /**
  * @brief The single output layer of this network.
+ * Its input is the hidden layer's a1, so it has no input vector of its own.
+ * weight and dWeight2 have one row of hidden_stride per output cell, the first hidden_units used.
  */
 
 struct OutputLayer{
-    OutputCell cell[NUMBER_OF_OUTPUT_CELLS];
+    double *weight;
+    double *dWeight2;
+    double *bias;
+    double *dbias2;
+    double *z2;
+    double *a2;
+    double *dz2;
+    double *da2;
 };
 
 
 /**
- * @brief The General layer of this network.
+ * @brief The General layer of this network, sized at runtime.
+ * The struct and all its arrays live in one aligned arena from createLayer; free it with freeLayer.
+ * The image is copied once into input, which all hidden units share.
+ * With BINARY_INPUT it is packed into input_bits instead, bit i set when pixel i is ink.
+ * active lists the ink pixels in increasing order; with SPARSE_GRADIENT only those
+ * columns of dWeight1 are written, the others hold stale values and must not be read.
  */
 
 struct GeneralLayer{
+    int hidden_units;
+    int hidden_stride;           /// hidden_units rounded up to a cache line of doubles.
+    double learning_rate;
+    size_t arena_size;           /// bytes in the arena, this struct included.
+
+    double *input;
+    uint64_t *input_bits;
+    uint16_t *active;
+    int active_count;
+
     HiddenLayer hidden_layer;
     OutputLayer output_layer;
 };
@@ -101,6 +112,8 @@ struct Vector{
 
 /// ######################################### Functions Set ##########################################
 Vector getTargetOutput(int targetIndex);
+GeneralLayer *createLayer(int hiddenUnits, double learningRate);
+void freeLayer(GeneralLayer *Gl);
 void initLayer(GeneralLayer *Gl);
 void setCellInput(GeneralLayer *Gl, MNIST_Image *img);
 void forward_Hidden_cell(GeneralLayer *Gl);
@@ -111,3 +124,4 @@ void Backward_Propagation(GeneralLayer *Gl,Vector *target);
 void Update_Weights(GeneralLayer *Gl);
 int getPrediction(GeneralLayer *Gl);
 int Prediction(GeneralLayer *Gl,MNIST_Image *img);
+void copy_Weights(GeneralLayer *dst, GeneralLayer const *src);
@@ -0,0 +1,202 @@
+/**
+ * @file Neural-Network-v1-idx.c
+ * @brief MNIST IDX files mapped into memory once, read as zero-copy image views by index.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define HAVE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "mnist-utils.h"
+#include "Neural-Network-v1-idx.h"
+
+#define IDX_IMAGE_MAGIC 0x00000803   /// unsigned bytes, 3 dimensions.
+#define IDX_LABEL_MAGIC 0x00000801   /// unsigned bytes, 1 dimension.
+#define IDX_IMAGE_HEADER 16          /// magic, count, rows, columns.
+#define IDX_LABEL_HEADER 8           /// magic, count.
+
+
+
+/**
+ * @details Reads the big endian 32 bit integer at p, as stored in IDX headers.
+ */
+
+static unsigned long readBigEndian(const unsigned char *p)
+{
+    return ((unsigned long)p[0] << 24) | ((unsigned long)p[1] << 16) | ((unsigned long)p[2] << 8) | p[3];
+}
+
+
+/**
+ * @details Maps the whole file, private and writable so views can be handed out as MNIST_Image *;
+ * writing to one copies just that page. Without mmap the file is read into memory instead.
+ * Returns 0 on failure.
+ */
+
+static void *loadFile(const char *fileName, size_t *size, int *mapped)
+{
+#ifdef HAVE_MMAP
+    const int fd = open(fileName, O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return 0;
+    }
+
+    void *map = mmap(0, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return 0;
+
+    *size = st.st_size;
+    *mapped = 1;
+    return map;
+#else
+    FILE *f = fopen(fileName, "rb");
+    if (!f) return 0;
+
+    void *data = 0;
+    long length = -1;
+    if (fseek(f, 0, SEEK_END) == 0) length = ftell(f);
+    if (length > 0 && fseek(f, 0, SEEK_SET) == 0) data = malloc(length);
+    if (data && fread(data, 1, length, f) != (size_t)length)
+    {
+        free(data);
+        data = 0;
+    }
+    fclose(f);
+
+    *size = length;
+    *mapped = 0;
+    return data;
+#endif
+}
+
+
+static void unloadFile(void *data, size_t size, int mapped)
+{
+    if (!data) return;
+#ifdef HAVE_MMAP
+    if (mapped)
+    {
+        munmap(data, size);
+        return;
+    }
+#endif
+    (void)size; (void)mapped;
+    free(data);
+}
+
+
+
+/**
+ * @details Opens an image file and its label file. Both headers are checked: the magic numbers,
+ * matching counts, images of exactly sizeof(MNIST_Image) pixels and files long enough to hold them.
+ * The order starts as the file order. Returns 0 on failure.
+ */
+
+MNIST_Dataset *openMNISTDataset(const char *imageFileName, const char *labelFileName)
+{
+    MNIST_Dataset *ds = calloc(1, sizeof(MNIST_Dataset));
+    if (!ds) return 0;
+
+    ds->image_data = loadFile(imageFileName, &ds->image_size, &ds->mapped);
+    ds->label_data = loadFile(labelFileName, &ds->label_size, &ds->mapped);
+
+    if (!ds->image_data || !ds->label_data ||
+        ds->image_size < IDX_IMAGE_HEADER || ds->label_size < IDX_LABEL_HEADER)
+    {
+        closeMNISTDataset(ds);
+        return 0;
+    }
+
+    const unsigned char *ih = ds->image_data;
+    const unsigned char *lh = ds->label_data;
+    const unsigned long count = readBigEndian(ih + 4);
+    const unsigned long pixels = readBigEndian(ih + 8) * readBigEndian(ih + 12);
+
+    if (readBigEndian(ih) != IDX_IMAGE_MAGIC || readBigEndian(lh) != IDX_LABEL_MAGIC ||
+        readBigEndian(lh + 4) != count || pixels != sizeof(MNIST_Image) || count > 0x7fffffff ||
+        (ds->image_size - IDX_IMAGE_HEADER) / sizeof(MNIST_Image) < count ||
+        ds->label_size - IDX_LABEL_HEADER < count)
+    {
+        closeMNISTDataset(ds);
+        return 0;
+    }
+
+    ds->count = (int)count;
+    ds->pixels = (unsigned char *)ds->image_data + IDX_IMAGE_HEADER;
+    ds->labels = (unsigned char *)ds->label_data + IDX_LABEL_HEADER;
+
+    ds->order = malloc(sizeof(int) * (count ? count : 1));
+    if (!ds->order)
+    {
+        closeMNISTDataset(ds);
+        return 0;
+    }
+
+    int i;
+    for (i=0; i<ds->count; i++) ds->order[i] = i;
+
+    return ds;
+}
+
+
+/**
+ * @details Returns image index of the file, in place; nothing is copied.
+ */
+
+MNIST_Image *getDatasetImage(MNIST_Dataset *ds, int index)
+{
+    return (MNIST_Image *)(ds->pixels + (size_t)index * sizeof(MNIST_Image));
+}
+
+
+MNIST_Label getDatasetLabel(MNIST_Dataset const *ds, int index)
+{
+    return ds->labels[index];
+}
+
+
+/**
+ * @details Shuffles the first count entries of the order (Fisher-Yates), leaving the rest,
+ * e.g. a validation split at the end, in place. seed must be nonzero and is advanced;
+ * the same seed gives the same order.
+ */
+
+void shuffleDataset(MNIST_Dataset *ds, int count, unsigned long long *seed)
+{
+    int i;
+    for (i=count-1; i>0; i--)
+    {
+        /// xorshift64*
+        *seed ^= *seed >> 12;
+        *seed ^= *seed << 25;
+        *seed ^= *seed >> 27;
+        const int j = (int)(((*seed * 2685821657736338717ull) >> 32) % (unsigned long long)(i + 1));
+
+        const int t = ds->order[i];
+        ds->order[i] = ds->order[j];
+        ds->order[j] = t;
+    }
+}
+
+
+void closeMNISTDataset(MNIST_Dataset *ds)
+{
+    if (!ds) return;
+    unloadFile(ds->image_data, ds->image_size, ds->mapped);
+    unloadFile(ds->label_data, ds->label_size, ds->mapped);
+    free(ds->order);
+    free(ds);
+}
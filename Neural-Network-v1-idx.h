@@ -0,0 +1,36 @@
+/**
+ * @file Neural-Network-v1-idx.h
+ * @brief MNIST IDX files mapped into memory once, read as zero-copy image views by index.
+ * Epochs are shuffled through a permutation of the indices; the images never move.
+ */
+
+
+#include <stddef.h>
+
+
+typedef struct MNIST_Dataset MNIST_Dataset;
+
+
+/**
+ * @brief An image file and its label file, mapped (or read, where mmap is missing) whole.
+ */
+
+struct MNIST_Dataset{
+    int count;                   /// number of images (= number of labels).
+    unsigned char *pixels;       /// count images of sizeof(MNIST_Image) bytes, back to back.
+    unsigned char *labels;       /// count labels, one byte each.
+    int *order;                  /// permutation of 0..count-1, the order to visit the images in.
+    void *image_data;            /// the whole image file, and its size.
+    size_t image_size;
+    void *label_data;            /// the whole label file, and its size.
+    size_t label_size;
+    int mapped;                  /// 1 if the files are mapped, 0 if they were read into memory.
+};
+
+
+/// ######################################### Functions Set ##########################################
+MNIST_Dataset *openMNISTDataset(const char *imageFileName, const char *labelFileName);
+MNIST_Image *getDatasetImage(MNIST_Dataset *ds, int index);
+MNIST_Label getDatasetLabel(MNIST_Dataset const *ds, int index);
+void shuffleDataset(MNIST_Dataset *ds, int count, unsigned long long *seed);
+void closeMNISTDataset(MNIST_Dataset *ds);
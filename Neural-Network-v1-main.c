@@ -20,6 +20,8 @@
 #include "mnist-utils.h"
 #include "mnist-stats.h"
 #include "Neural-Network-v1-NN.h"
+#include "Neural-Network-v1-idx.h"
+#include "genann_stop.h"
 
 
 
@@ -30,13 +32,7 @@
 
  */
 
-void Test_Neural_Network(GeneralLayer *Gl){
-// open MNIST files
-        FILE *imageFile, *labelFile;
-        imageFile = openMNISTImageFile(MNIST_TESTING_SET_IMAGE_FILE_NAME);
-        labelFile = openMNISTLabelFile(MNIST_TESTING_SET_LABEL_FILE_NAME);
-
-
+void Test_Neural_Network(GeneralLayer *Gl, MNIST_Dataset *testSet){
         // screen output for monitoring progress
         displayImageFrame(7,5);
 
@@ -49,18 +45,18 @@ void Test_Neural_Network(GeneralLayer *Gl){
         // display progress
         displayLoadingProgressTesting(imgCount,5,5);
 
-        // Reading next image and corresponding label
-        MNIST_Image img = getImage(imageFile);
-        MNIST_Label lbl = getLabel(labelFile);
+        // View of the next image, and its label
+        MNIST_Image *img = getDatasetImage(testSet, imgCount);
+        MNIST_Label lbl = getDatasetLabel(testSet, imgCount);
 
         // set target Output of the number displayed in the current image (=label) to 1, all others to 0
         Vector targetOutput;
         targetOutput = getTargetOutput(lbl);
 
-        displayImage(&img, 8,6);
+        displayImage(img, 8,6);
 
 
-        int predictedNum =Prediction(Gl,&img);
+        int predictedNum =Prediction(Gl,img);
 
         if (predictedNum!=lbl) errCount++;
 
@@ -85,8 +81,6 @@ void Test_Neural_Network(GeneralLayer *Gl){
 
     // Close files
     fclose(f);
-    fclose(imageFile);
-    fclose(labelFile);
 
 
 }
@@ -121,6 +115,7 @@ double Neural_Network(GeneralLayer *Gl,MNIST_Image *img, Vector *targetOutput){
 
 /**
  * @details Main function to run MNIST-1LNN
+ * Usage: [hidden units] [learning rate] [iterations], default HIDDEN_UNITS, LEARNING_RATE, NUMITERATIONS.
  */
 
 int main(int argc, const char * argv[]) {
@@ -131,18 +126,46 @@ int main(int argc, const char * argv[]) {
     clearScreen();
     printf("#################################### Beginning ##########################################");
 
+        const int hiddenUnits = argc > 1 ? atoi(argv[1]) : HIDDEN_UNITS;
+        const double learningRate = argc > 2 ? atof(argv[2]) : LEARNING_RATE;
+        const int iterations = argc > 3 ? atoi(argv[3]) : NUMITERATIONS;
 
     /// #######################################  (General Layer) ##############################################
-        GeneralLayer general_layer;
+    /// One arena per layer, sized for hiddenUnits; best_layer keeps the weights of the best iteration.
+        GeneralLayer *general_layer = createLayer(hiddenUnits, learningRate);
+        GeneralLayer *best_layer = createLayer(hiddenUnits, learningRate);
+        if (!general_layer || !best_layer)
+        {
+            printf("Can not allocate a network of %d hidden units !\n", hiddenUnits);
+            return 1;
+        }
     /// #######################################   Parameters initialization             #######################
-        initLayer(&general_layer);
+        initLayer(general_layer);
 
 
+    /// #######################################   MNIST files, mapped once  ####################################
+        MNIST_Dataset *trainSet = openMNISTDataset(MNIST_TRAINING_SET_IMAGE_FILE_NAME, MNIST_TRAINING_SET_LABEL_FILE_NAME);
+        MNIST_Dataset *testSet = openMNISTDataset(MNIST_TESTING_SET_IMAGE_FILE_NAME, MNIST_TESTING_SET_LABEL_FILE_NAME);
+        if (!trainSet || !testSet || trainSet->count < MNIST_MAX_TRAINING_IMAGES || testSet->count < MNIST_MAX_TESTING_IMAGES)
+        {
+            printf("MNIST files can not be opened !\n");
+            return 1;
+        }
+        unsigned long long shuffleSeed = SHUFFLE_SEED;
+
     /// #######################################       Training          #########################################
+    /// The last VALIDATION_IMAGES training images are only used to decide when to stop.
+      genann_stop *stop = genann_stop_init(PATIENCE, MIN_DELTA);
+      if (!stop)
+      {
+          printf("Can not allocate the early stopping state !\n");
+          return 1;
+      }
+      const int trainImages = MNIST_MAX_TRAINING_IMAGES - VALIDATION_IMAGES;
 
       int iteration;
 
-      for(iteration=0;iteration<NUMITERATIONS;iteration++)
+      for(iteration=0;iteration<iterations;iteration++)
       {
         printf("########################################### Iteration %d ##############################################",iteration);
         double cost=0;
@@ -150,37 +173,36 @@ int main(int argc, const char * argv[]) {
         Vector targetOutput; /// a Label will convert to 0-1 format eg: 5 -> 0000100000.
         int errCount = 0; /// error counter.
        /// ###################################### Image Processing ########################################
-        /// open MNIST files
-        FILE *imageFile, *labelFile;
-        imageFile = openMNISTImageFile(MNIST_TRAINING_SET_IMAGE_FILE_NAME);
-        labelFile = openMNISTLabelFile(MNIST_TRAINING_SET_LABEL_FILE_NAME);
+        /// visit the training images in a new order each iteration; only the indices move.
+        shuffleDataset(trainSet, trainImages, &shuffleSeed);
 
         /// screen output for monitoring progress
         displayImageFrame(5,5);
 
         /// Loop through all images in the file.
         int imgCount;
-        for ( imgCount=0; imgCount<MNIST_MAX_TRAINING_IMAGES; imgCount++)
+        for ( imgCount=0; imgCount<trainImages; imgCount++)
         {
 
         /// display progress
            displayLoadingProgressTraining(imgCount,3,5);
 
-        /// Reading next image and corresponding label
-            MNIST_Image img = getImage(imageFile);
-            MNIST_Label lbl = getLabel(labelFile);
+        /// View of the next image and its label
+            const int index = trainSet->order[imgCount];
+            MNIST_Image *img = getDatasetImage(trainSet, index);
+            MNIST_Label lbl = getDatasetLabel(trainSet, index);
 
         /// set target Output of the number displayed in the current image's label to 1, all others to 0
 
             targetOutput = getTargetOutput(lbl);
 
-            displayImage(&img, 6,6);
+            displayImage(img, 6,6);
 
         /// ############################# Neural Network ###################################################################
-            cost+=Neural_Network(&general_layer,&img,&targetOutput);
+            cost+=Neural_Network(general_layer,img,&targetOutput);
 
 
-            int predictedNum = getPrediction(&general_layer);
+            int predictedNum = getPrediction(general_layer);
             if (predictedNum!=lbl) errCount++;
 
             printf("\n      Prediction: %d   Actual: %d \n",predictedNum, lbl);
@@ -196,7 +218,7 @@ int main(int argc, const char * argv[]) {
 
              printf("############################# Cost training image #################################### \n\n\n");
 
-             cost=(cost/MNIST_MAX_TRAINING_IMAGES);
+             cost=(cost/trainImages);
              FILE *f;
              f = fopen("Training_report.txt", "a");
 
@@ -209,19 +231,42 @@ int main(int argc, const char * argv[]) {
              printf("Cost in iteration %d: %lf \n\n",iteration,cost);
              delay(2000);
 
-            fclose(imageFile);
-            fclose(labelFile);
-
-
+        /// ###########################################  Validation  ##########################################################
+        /// Exactly like training but WITHOUT LEARNING, on the held out images that follow.
+            double validCost=0;
+            for ( ; imgCount<MNIST_MAX_TRAINING_IMAGES; imgCount++)
+            {
+                MNIST_Image *img = getDatasetImage(trainSet, imgCount);
+                MNIST_Label lbl = getDatasetLabel(trainSet, imgCount);
+
+                targetOutput = getTargetOutput(lbl);
+                Forward_Propagation(general_layer,img);
+                validCost+=Cost_Function(general_layer,&targetOutput);
+            }
+            validCost=validCost/VALIDATION_IMAGES;
+            printf("Validation cost in iteration %d: %lf \n\n",iteration,validCost);
+
+            /// Keep the weights of the best iteration, stop once the validation cost plateaus.
+            const int done = genann_stop_update(stop, 0, validCost);
+            if (genann_stop_improved(stop)) copy_Weights(best_layer,general_layer);
+            if (done) break;
 
     }
 
+        /// No best iteration if none ran (iterations <= 0) or the first cost was NaN.
+        if (stop->best_epoch)
+        {
+            copy_Weights(general_layer,best_layer);
+            printf("Best validation cost %lf in iteration %d \n\n",stop->best_loss,stop->best_epoch-1);
+        }
+        genann_stop_free(stop);
+
     /// #################################################  Testing  #################################################
 
-        Test_Neural_Network(&general_layer);
+        Test_Neural_Network(general_layer, testSet);
 
         locateCursor(38, 5);
-        export_Weights(&general_layer);
+        export_Weights(general_layer);
 
         /// Calculate and print the program's total execution time
         time_t endTime = time(NULL);
@@ -229,6 +274,10 @@ int main(int argc, const char * argv[]) {
         printf("\n    DONE! Total execution time: %.1f sec\n\n",executionTime);
 
         ///  ###################### free the allocated space used in init_layer function  ###################
+        closeMNISTDataset(trainSet);
+        closeMNISTDataset(testSet);
+        freeLayer(best_layer);
+        freeLayer(general_layer);
 
 
         return 0;
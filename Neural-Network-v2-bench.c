@@ -0,0 +1,596 @@
+/**
+ * @file Neural-Network-v2-bench.c
+ * @brief Benchmarks genann inference, training, evaluation and model I/O over a sweep of
+ * topologies and batch sizes, and prints one CSV row (or JSON object) per case.
+ *
+ * Usage: bench [options]
+ *   -i LIST   input counts            (default 8,64,784)
+ *   -w LIST   hidden widths           (default 16,128)
+ *   -l LIST   hidden layer counts     (default 1,2)
+ *   -o LIST   output counts           (default 1,10)
+ *   -b LIST   batch sizes             (default 1,64)
+ *   -t LIST   thread counts for the parallel trainer and evaluation (default 1)
+ *   -r N      timed repetitions per case (default 5)
+ *   -u N      warmup repetitions per case (default 1)
+ *   -m MS     target milliseconds per repetition (default 20)
+ *   -j        JSON instead of CSV
+ * LIST is comma separated, e.g. -w 32,256.
+ *
+ * With -d TRAIN,TEST the sweep is replaced by a time-to-accuracy run on two
+ * csv files (label in the last column): the same network is trained from
+ * the same seed on raw, z-score and min-max normalized features, and the
+ * epochs and seconds until test accuracy first reaches the target are
+ * reported. The network is the first entry of -l and -w, the batch the
+ * first entry of -b.
+ *   -n N      train on the first N rows only (default all)
+ *   -A PCT    target test accuracy in percent (default 75)
+ *   -E N      maximum epochs (default 1000)
+ *   -L RATE   learning rate (default 0.001)
+ *
+ * ns/sample and samples/s are the mean over repetitions, with the standard
+ * deviation and the fastest repetition alongside. For I/O cases a sample is
+ * one whole model. GFLOP/s counts a multiply-add as two flops: 2 per weight
+ * forward, 6 per weight for training (forward, backward, update). bytes/sample
+ * is the memory a sample has to touch if nothing stays in cache: weights
+ * (amortized over the batch), inputs and outputs, or the file size for I/O.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "genann.h"
+#include "genann_simd.h"
+#include "genann_parallel.h"
+#include "genann_csv.h"
+#include "genann_norm.h"
+#include "genann_eval.h"
+
+#define MAX_LIST 16
+#define BENCH_FILE "genann_bench.tmp"
+
+
+typedef struct list {
+    int n;
+    int v[MAX_LIST];
+} list;
+
+
+typedef struct result {
+    double mean_ns, stddev_ns, min_ns;
+    double flops, bytes;
+} result;
+
+
+/* One benchmark case: runs count samples, or count whole-model I/O ops. */
+typedef struct bench_case {
+    genann *ann;
+    genann *copy;
+    genann_pool *pool;
+    genann_threads *threads;
+    genann_real *inputs, *desired, *outputs;
+
+    /* genann_train_batch_r work space for batch observations. */
+    genann_real *work;
+    int batch;
+} bench_case;
+
+typedef void (*bench_fn)(bench_case *c, int count);
+
+
+static double now_ns(void) {
+#if defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+#else
+    return (double)clock() * (1e9 / CLOCKS_PER_SEC);
+#endif
+}
+
+
+static int parse_list(char const *s, list *l) {
+    l->n = 0;
+    while (*s && l->n < MAX_LIST) {
+        char *end;
+        const long v = strtol(s, &end, 10);
+        if (end == s || v < 0) return -1;
+        l->v[l->n++] = (int)v;
+        s = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return -1;
+    }
+    return l->n ? 0 : -1;
+}
+
+
+static void do_run(bench_case *c, int count) {
+    const int inputs = c->ann->inputs;
+    int i;
+    for (i = 0; i < count; ++i) {
+        genann_run(c->ann, c->inputs + (size_t)(i % c->batch) * inputs);
+    }
+}
+
+
+static void do_run_batch(bench_case *c, int count) {
+    int i;
+    for (i = 0; i < count; i += c->batch) {
+        genann_run_batch(c->ann, c->inputs, c->batch, c->outputs);
+    }
+}
+
+
+static void do_evaluate(bench_case *c, int count) {
+    int i;
+    for (i = 0; i < count; i += c->batch) {
+        genann_metrics_free(genann_evaluate(c->ann, c->threads, c->inputs, c->desired, c->batch));
+    }
+}
+
+
+static void do_train(bench_case *c, int count) {
+    const int inputs = c->ann->inputs, outputs = c->ann->outputs;
+    int i;
+    for (i = 0; i < count; ++i) {
+        const int k = i % c->batch;
+        genann_train(c->ann, c->inputs + (size_t)k * inputs, c->desired + (size_t)k * outputs, 1e-6);
+    }
+}
+
+
+static void do_train_batch(bench_case *c, int count) {
+    int i;
+    for (i = 0; i < count; i += c->batch) {
+        genann_train_batch_r(c->ann, c->inputs, c->desired, c->batch, 1e-6, c->work);
+    }
+}
+
+
+static void do_train_parallel(bench_case *c, int count) {
+    int i;
+    for (i = 0; i < count; i += c->batch) {
+        genann_train_parallel(c->ann, c->threads, c->inputs, c->desired, c->batch, c->batch, 1e-6, GENANN_PARALLEL_SYNC);
+    }
+}
+
+
+static void do_write(bench_case *c, int count) {
+    int i;
+    for (i = 0; i < count; ++i) {
+        FILE *out = fopen(BENCH_FILE, "w");
+        genann_write(c->ann, out);
+        fclose(out);
+    }
+}
+
+
+static void do_read(bench_case *c, int count) {
+    int i;
+    (void)c;
+    for (i = 0; i < count; ++i) {
+        FILE *in = fopen(BENCH_FILE, "r");
+        genann_free(genann_read(in));
+        fclose(in);
+    }
+}
+
+
+static void do_write_binary(bench_case *c, int count) {
+    int i;
+    for (i = 0; i < count; ++i) {
+        FILE *out = fopen(BENCH_FILE, "wb");
+        genann_write_binary(c->ann, out);
+        fclose(out);
+    }
+}
+
+
+static void do_copy(bench_case *c, int count) {
+    int i;
+    for (i = 0; i < count; ++i) {
+        genann_free(genann_copy(c->ann));
+    }
+}
+
+
+static void do_copy_into(bench_case *c, int count) {
+    int i;
+    for (i = 0; i < count; ++i) {
+        genann_copy_into(c->copy, c->ann);
+    }
+}
+
+
+static void do_pool_copy(bench_case *c, int count) {
+    int i;
+    for (i = 0; i < count; ++i) {
+        genann_free(genann_pool_copy(c->pool, c->ann));
+    }
+}
+
+
+static void do_read_binary(bench_case *c, int count) {
+    int i;
+    (void)c;
+    for (i = 0; i < count; ++i) {
+        FILE *in = fopen(BENCH_FILE, "rb");
+        genann_free(genann_read_binary(in));
+        fclose(in);
+    }
+}
+
+
+static void do_map(bench_case *c, int count) {
+    int i;
+    (void)c;
+    for (i = 0; i < count; ++i) {
+        genann_free(genann_map(BENCH_FILE, 0));
+    }
+}
+
+
+static long file_size(char const *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+    fseek(f, 0, SEEK_END);
+    const long size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+
+/* Times fn: sizes a repetition to roughly target_ms, then runs warmup and
+ * timed repetitions of that many samples. step is the granularity of count. */
+static result measure(bench_fn fn, bench_case *c, int step, int warmup, int reps, double target_ms) {
+    result r;
+    int count = step;
+
+    /* Grow count until one repetition takes long enough to time. */
+    for (;;) {
+        const double t0 = now_ns();
+        fn(c, count);
+        const double t = now_ns() - t0;
+        if (t >= target_ms * 1e6 || count >= (1 << 26)) break;
+        const double grow = t > 0 ? target_ms * 1e6 / t * 1.1 : 16;
+        const double next = count * (grow > 16 ? 16 : grow < 2 ? 2 : grow);
+        count = ((int)next + step - 1) / step * step;
+    }
+
+    int i;
+    for (i = 0; i < warmup; ++i) fn(c, count);
+
+    double sum = 0, sum2 = 0;
+    r.min_ns = 1e300;
+    for (i = 0; i < reps; ++i) {
+        const double t0 = now_ns();
+        fn(c, count);
+        const double ns = (now_ns() - t0) / count;
+        sum += ns;
+        sum2 += ns * ns;
+        if (ns < r.min_ns) r.min_ns = ns;
+    }
+
+    r.mean_ns = sum / reps;
+    const double var = sum2 / reps - r.mean_ns * r.mean_ns;
+    r.stddev_ns = var > 0 ? sqrt(var) : 0;
+    r.flops = r.bytes = 0;
+    return r;
+}
+
+
+static void print_result(int json, int *first, char const *op, genann const *ann, int batch, int threads, result const *r) {
+    const double gflops = r->flops / r->mean_ns;
+    if (json) {
+        printf("%s\n  {\"op\": \"%s\", \"inputs\": %d, \"hidden_layers\": %d, \"hidden\": %d, \"outputs\": %d, "
+               "\"weights\": %d, \"batch\": %d, \"threads\": %d, \"ns_per_sample\": %.3f, \"stddev_ns\": %.3f, "
+               "\"min_ns\": %.3f, \"samples_per_s\": %.1f, \"gflops\": %.4f, \"bytes_per_sample\": %.1f}",
+               *first ? "" : ",", op, ann->inputs, ann->hidden_layers, ann->hidden, ann->outputs,
+               ann->total_weights, batch, threads, r->mean_ns, r->stddev_ns, r->min_ns,
+               1e9 / r->mean_ns, gflops, r->bytes);
+    } else {
+        printf("%s,%d,%d,%d,%d,%d,%d,%d,%.3f,%.3f,%.3f,%.1f,%.4f,%.1f\n",
+               op, ann->inputs, ann->hidden_layers, ann->hidden, ann->outputs,
+               ann->total_weights, batch, threads, r->mean_ns, r->stddev_ns, r->min_ns,
+               1e9 / r->mean_ns, gflops, r->bytes);
+    }
+    *first = 0;
+    fflush(stdout);
+}
+
+
+static double test_accuracy(genann const *ann, genann_csv const *test, genann_real *predicted) {
+    genann_run_batch(ann, test->data, test->rows, predicted);
+    int i, correct = 0;
+    for (i = 0; i < test->rows; ++i) {
+        if ((predicted[i] > 0.5) == (test->labels[i] > 0.5)) ++correct;
+    }
+    return 100.0 * correct / test->rows;
+}
+
+
+/* Trains with each normalization mode and reports time to target accuracy.
+ * Only fitting, normalizing and training are timed, not the evaluations. */
+static int time_to_accuracy(char const *files, int max_rows, int hidden_layers, int hidden, int batch,
+        double learning_rate, double target, int max_epochs, int json) {
+    char train_file[1024];
+    char const *comma = strchr(files, ',');
+    if (!comma || comma - files >= (int)sizeof(train_file)) return -1;
+    memcpy(train_file, files, comma - files);
+    train_file[comma - files] = 0;
+
+    static char const *const norm_name[] = {"none", "zscore", "minmax"};
+    if (json) {
+        printf("{\"time_to_accuracy\": [");
+    } else {
+        printf("op,norm,inputs,hidden_layers,hidden,batch,learning_rate,target,epochs,seconds,final_accuracy,best_accuracy\n");
+    }
+
+    int mode;
+    for (mode = -1; mode <= GENANN_NORM_MINMAX; ++mode) {
+        genann_csv *train = genann_csv_load(train_file, -1, ',', 0);
+        genann_csv *test = genann_csv_load(comma + 1, -1, ',', 0);
+        if (!train || !test || train->features != test->features) return -1;
+        const int rows = max_rows > 0 && max_rows < train->rows ? max_rows : train->rows;
+
+        srand(1);
+        genann *ann = genann_init(train->features, hidden_layers, hidden, 1);
+        genann_real *predicted = malloc(sizeof(genann_real) * test->rows);
+        genann_real *work = ann ? malloc(sizeof(genann_real) * genann_train_batch_work(ann, batch)) : 0;
+        if (!ann || !predicted || !work) return -1;
+
+        double start = now_ns(), elapsed = 0;
+        if (mode >= 0) {
+            genann_norm *norm = genann_norm_fit(train->data, rows, train->features, mode);
+            genann_norm_apply(norm, train->data, rows);
+            genann_norm_apply(norm, test->data, test->rows);
+            genann_norm_free(norm);
+        }
+
+        int epoch, reached = -1;
+        double accuracy = 0, best = 0, seconds = -1;
+        for (epoch = 1; epoch <= max_epochs; ++epoch) {
+            int b;
+            for (b = 0; b < rows; b += batch) {
+                genann_train_batch_r(ann, train->data + (size_t)b * train->features, train->labels + b,
+                        rows - b < batch ? rows - b : batch, learning_rate, work);
+            }
+            elapsed += now_ns() - start;
+
+            accuracy = test_accuracy(ann, test, predicted);
+            if (accuracy > best) best = accuracy;
+            if (reached < 0 && accuracy >= target) {
+                reached = epoch;
+                seconds = elapsed * 1e-9;
+            }
+            start = now_ns();
+        }
+
+        if (json) {
+            printf("%s\n  {\"norm\": \"%s\", \"inputs\": %d, \"hidden_layers\": %d, \"hidden\": %d, \"batch\": %d, "
+                   "\"learning_rate\": %g, \"target\": %g, \"epochs\": %d, \"seconds\": %.6f, "
+                   "\"final_accuracy\": %.3f, \"best_accuracy\": %.3f}",
+                   mode < 0 ? "" : ",", norm_name[mode + 1], ann->inputs, hidden_layers, hidden, batch,
+                   learning_rate, target, reached, seconds, accuracy, best);
+        } else {
+            printf("tta,%s,%d,%d,%d,%d,%g,%g,%d,%.6f,%.3f,%.3f\n",
+                   norm_name[mode + 1], ann->inputs, hidden_layers, hidden, batch,
+                   learning_rate, target, reached, seconds, accuracy, best);
+        }
+        fflush(stdout);
+
+        free(predicted);
+        free(work);
+        genann_free(ann);
+        genann_csv_free(train);
+        genann_csv_free(test);
+    }
+
+    if (json) printf("\n]}\n");
+    return 0;
+}
+
+
+static void usage(void) {
+    fprintf(stderr, "usage: bench [-i LIST] [-w LIST] [-l LIST] [-o LIST] [-b LIST] [-t LIST] [-r N] [-u N] [-m MS] [-j]\n"
+                    "       bench -d TRAIN,TEST [-l N] [-w N] [-b N] [-n ROWS] [-A PCT] [-E EPOCHS] [-L RATE] [-j]\n");
+}
+
+
+int main(int argc, char *argv[])
+{
+    list inputs = {3, {8, 64, 784}};
+    list hidden = {2, {16, 128}};
+    list layers = {2, {1, 2}};
+    list outputs = {2, {1, 10}};
+    list batches = {2, {1, 64}};
+    list threads = {1, {1}};
+    int reps = 5, warmup = 1, json = 0;
+    double target_ms = 20;
+    char const *dataset = 0;
+    int max_rows = 0, max_epochs = 1000;
+    double target_accuracy = 75, learning_rate = 0.001;
+
+    int a;
+    for (a = 1; a < argc; ++a) {
+        char const *opt = argv[a];
+        if (strcmp(opt, "-j") == 0) { json = 1; continue; }
+        if (opt[0] != '-' || !opt[1] || opt[2] || a + 1 >= argc) { usage(); return 1; }
+        char const *val = argv[++a];
+        int bad = 0;
+        switch (opt[1]) {
+            case 'i': bad = parse_list(val, &inputs); break;
+            case 'w': bad = parse_list(val, &hidden); break;
+            case 'l': bad = parse_list(val, &layers); break;
+            case 'o': bad = parse_list(val, &outputs); break;
+            case 'b': bad = parse_list(val, &batches); break;
+            case 't': bad = parse_list(val, &threads); break;
+            case 'r': reps = atoi(val); bad = reps < 1; break;
+            case 'u': warmup = atoi(val); bad = warmup < 0; break;
+            case 'm': target_ms = atof(val); bad = target_ms <= 0; break;
+            case 'd': dataset = val; break;
+            case 'n': max_rows = atoi(val); break;
+            case 'A': target_accuracy = atof(val); break;
+            case 'E': max_epochs = atoi(val); bad = max_epochs < 1; break;
+            case 'L': learning_rate = atof(val); bad = learning_rate <= 0; break;
+            default: bad = 1;
+        }
+        if (bad) { usage(); return 1; }
+    }
+
+    if (dataset) {
+        const int batch = batches.v[0] > 0 ? batches.v[0] : 1;
+        if (time_to_accuracy(dataset, max_rows, layers.v[0], hidden.v[0], batch,
+                    learning_rate, target_accuracy, max_epochs, json) != 0) {
+            fprintf(stderr, "bench: cannot load %s\n", dataset);
+            return 1;
+        }
+        return 0;
+    }
+
+    static char const *const level_name[] = {"scalar", "sse2", "avx2", "avx512"};
+    if (json) {
+        printf("{\"genann_real_bytes\": %d, \"simd\": \"%s\", \"reps\": %d, \"warmup\": %d, \"results\": [",
+               (int)sizeof(genann_real), level_name[genann_simd_level()], reps, warmup);
+    } else {
+        printf("# genann_real_bytes=%d simd=%s reps=%d warmup=%d\n",
+               (int)sizeof(genann_real), level_name[genann_simd_level()], reps, warmup);
+        printf("op,inputs,hidden_layers,hidden,outputs,weights,batch,threads,ns_per_sample,stddev_ns,min_ns,samples_per_s,gflops,bytes_per_sample\n");
+    }
+
+    int first = 1;
+    int ii, wi, li, oi, bi, ti;
+    for (ii = 0; ii < inputs.n; ++ii)
+    for (li = 0; li < layers.n; ++li)
+    for (wi = 0; wi < hidden.n; ++wi)
+    for (oi = 0; oi < outputs.n; ++oi) {
+        /* Hidden width is meaningless without hidden layers; run it once. */
+        if (layers.v[li] == 0 && wi > 0) continue;
+
+        genann *ann = genann_init(inputs.v[ii], layers.v[li], layers.v[li] ? hidden.v[wi] : 0, outputs.v[oi]);
+        if (!ann) {
+            fprintf(stderr, "bench: cannot create %d-%dx%d-%d\n", inputs.v[ii], layers.v[li], hidden.v[wi], outputs.v[oi]);
+            continue;
+        }
+
+        const double w = ann->total_weights;
+        const double weight_bytes = w * sizeof(genann_real);
+        const double io_bytes = (double)(ann->inputs + ann->outputs) * sizeof(genann_real);
+
+        for (bi = 0; bi < batches.n; ++bi) {
+            const int batch = batches.v[bi] > 0 ? batches.v[bi] : 1;
+            bench_case c;
+            c.ann = ann;
+            c.threads = 0;
+            c.batch = batch;
+            c.inputs = malloc(sizeof(genann_real) * (size_t)batch * ann->inputs);
+            c.desired = malloc(sizeof(genann_real) * (size_t)batch * ann->outputs);
+            c.outputs = malloc(sizeof(genann_real) * (size_t)batch * ann->outputs);
+            c.work = malloc(sizeof(genann_real) * genann_train_batch_work(ann, batch));
+            if (!c.inputs || !c.desired || !c.outputs || !c.work) {
+                fprintf(stderr, "bench: out of memory\n");
+                return 1;
+            }
+
+            size_t k;
+            for (k = 0; k < (size_t)batch * ann->inputs; ++k) c.inputs[k] = GENANN_RANDOM();
+            for (k = 0; k < (size_t)batch * ann->outputs; ++k) c.desired[k] = GENANN_RANDOM();
+
+            result r;
+
+            /* Per-sample calls do not depend on the batch size; time them once. */
+            if (bi == 0) {
+                r = measure(do_run, &c, 1, warmup, reps, target_ms);
+                r.flops = 2 * w;
+                r.bytes = weight_bytes + io_bytes;
+                print_result(json, &first, "run", ann, 1, 1, &r);
+
+                r = measure(do_train, &c, 1, warmup, reps, target_ms);
+                r.flops = 6 * w;
+                r.bytes = 2 * weight_bytes + io_bytes;
+                print_result(json, &first, "train", ann, 1, 1, &r);
+            }
+
+            r = measure(do_run_batch, &c, batch, warmup, reps, target_ms);
+            r.flops = 2 * w;
+            r.bytes = weight_bytes / batch + io_bytes;
+            print_result(json, &first, "run_batch", ann, batch, 1, &r);
+
+            r = measure(do_train_batch, &c, batch, warmup, reps, target_ms);
+            r.flops = 6 * w;
+            r.bytes = 2 * weight_bytes / batch + io_bytes;
+            print_result(json, &first, "train_batch", ann, batch, 1, &r);
+
+            for (ti = 0; ti < threads.n; ++ti) {
+                c.threads = genann_threads_create(threads.v[ti] > 0 ? threads.v[ti] : 1);
+                if (!c.threads) continue;
+                r = measure(do_train_parallel, &c, batch, warmup, reps, target_ms);
+                r.flops = 6 * w;
+                r.bytes = 2 * weight_bytes / batch + io_bytes;
+                print_result(json, &first, "train_parallel", ann, batch, genann_threads_count(c.threads), &r);
+
+                r = measure(do_evaluate, &c, batch, warmup, reps, target_ms);
+                r.flops = 2 * w;
+                r.bytes = weight_bytes / batch + io_bytes;
+                print_result(json, &first, "evaluate", ann, batch, genann_threads_count(c.threads), &r);
+                genann_threads_free(c.threads);
+                c.threads = 0;
+            }
+
+            free(c.inputs);
+            free(c.desired);
+            free(c.outputs);
+            free(c.work);
+        }
+
+        /* Model I/O, one sample per whole model. */
+        bench_case c;
+        memset(&c, 0, sizeof(c));
+        c.ann = ann;
+
+        result r = measure(do_write, &c, 1, warmup, reps, target_ms);
+        r.bytes = file_size(BENCH_FILE);
+        print_result(json, &first, "write", ann, 1, 1, &r);
+
+        r = measure(do_read, &c, 1, warmup, reps, target_ms);
+        r.bytes = file_size(BENCH_FILE);
+        print_result(json, &first, "read", ann, 1, 1, &r);
+
+        r = measure(do_write_binary, &c, 1, warmup, reps, target_ms);
+        r.bytes = file_size(BENCH_FILE);
+        print_result(json, &first, "write_binary", ann, 1, 1, &r);
+
+        r = measure(do_read_binary, &c, 1, warmup, reps, target_ms);
+        r.bytes = file_size(BENCH_FILE);
+        print_result(json, &first, "read_binary", ann, 1, 1, &r);
+
+        r = measure(do_map, &c, 1, warmup, reps, target_ms);
+        r.bytes = file_size(BENCH_FILE);
+        print_result(json, &first, "map", ann, 1, 1, &r);
+
+        /* Snapshots: a fresh copy, a copy into an existing ann, a pooled copy. */
+        r = measure(do_copy, &c, 1, warmup, reps, target_ms);
+        r.bytes = 2 * weight_bytes;
+        print_result(json, &first, "copy", ann, 1, 1, &r);
+
+        c.copy = genann_freeze(ann);
+        r = measure(do_copy_into, &c, 1, warmup, reps, target_ms);
+        r.bytes = 2 * weight_bytes;
+        print_result(json, &first, "copy_into", ann, 1, 1, &r);
+        genann_free(c.copy);
+
+        c.pool = genann_pool_create(ann, 1);
+        r = measure(do_pool_copy, &c, 1, warmup, reps, target_ms);
+        r.bytes = 2 * weight_bytes;
+        print_result(json, &first, "pool_copy", ann, 1, 1, &r);
+        genann_pool_free(c.pool);
+
+        genann_free(ann);
+    }
+
+    remove(BENCH_FILE);
+
+    if (json) printf("\n]}\n");
+    return 0;
+}
@@ -0,0 +1,194 @@
+/**
+ * @file Neural-Network-v2-evalcheck.c
+ * @brief Checks genann_evaluate against a brute force reference: accuracy,
+ * confusion counts and ROC AUC with ties, for one and several outputs and
+ * every thread count up to MAX_THREADS. Also checks that a NaN score leaves
+ * the AUC undefined (-1) instead of hanging the merge.
+ * Exits nonzero if any metric differs.
+ * Usage: evalcheck [seed], default 1.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "genann.h"
+#include "genann_eval.h"
+#include "genann_threads.h"
+
+#define MAX_LENGTH  300
+#define MAX_THREADS  4
+#define MAX_CLASSES  3
+
+/* AUCs are sums of halves over at most MAX_LENGTH^2 pairs, then divided. */
+#define AUC_TOL  1e-12
+
+static int failures = 0;
+
+
+static void expect(const char *what, int classes, int n, int threads, double got, double want, double tol)
+{
+    if (!(fabs(got - want) <= tol))
+    {
+        if (failures < 20)
+            printf("%s, %d classes, n=%d, %d threads: got %.17g, reference %.17g\n",
+                   what, classes, n, threads, got, want);
+        failures++;
+    }
+}
+
+
+/* An ann whose outputs equal its inputs, so the test data are the scores. */
+static genann *identity(int outputs)
+{
+    genann *ann = genann_init(outputs, 0, 0, outputs);
+    int j, k;
+
+    genann_set_activation(ann, GENANN_ACT_LINEAR, GENANN_ACT_LINEAR);
+    for (j = 0; j < outputs; ++j)
+    {
+        genann_real *w = ann->weight + j * (outputs + 1);
+        w[0] = 0;
+        for (k = 0; k < outputs; ++k) w[1 + k] = j == k;
+    }
+    return ann;
+}
+
+
+static int argmax(genann_real const *x, int n)
+{
+    int k, best = 0;
+    for (k = 1; k < n; ++k) if (x[k] > x[best]) best = k;
+    return best;
+}
+
+
+/* One-vs-rest AUC of column c over every positive/negative pair, -1 if
+ * undefined. */
+static double reference_auc(genann_real const *score, int const *actual, int n, int outputs, int c, int positive)
+{
+    double pairs = 0, positives = 0, negatives = 0;
+    int i, j;
+    for (i = 0; i < n; ++i)
+    {
+        if (actual[i] == positive) positives++;
+        else negatives++;
+    }
+    if (positives == 0 || negatives == 0) return -1;
+
+    for (i = 0; i < n; ++i)
+    {
+        if (actual[i] != positive) continue;
+        for (j = 0; j < n; ++j)
+        {
+            if (actual[j] == positive) continue;
+            const genann_real p = score[(size_t)i * outputs + c], q = score[(size_t)j * outputs + c];
+            pairs += p > q ? 1 : p == q ? 0.5 : 0;
+        }
+    }
+    return pairs / (positives * negatives);
+}
+
+
+static void check(genann const *ann, genann_threads *threads, genann_real const *x, genann_real const *y, int n)
+{
+    const int outputs = ann->outputs, classes = outputs == 1 ? 2 : outputs;
+    const int count = threads ? genann_threads_count(threads) : 1;
+    int *actual = malloc(sizeof(int) * n);
+    long confusion[MAX_CLASSES * MAX_CLASSES] = {0};
+    int i, c, correct = 0;
+
+    for (i = 0; i < n; ++i)
+    {
+        genann_real const *o = x + (size_t)i * outputs, *t = y + (size_t)i * outputs;
+        const int a = outputs == 1 ? t[0] > 0.5 : argmax(t, outputs);
+        const int p = outputs == 1 ? o[0] > 0.5 : argmax(o, outputs);
+        actual[i] = a;
+        confusion[a * classes + p]++;
+        correct += a == p;
+    }
+
+    double auc = 0;
+    int columns = 0;
+    for (c = 0; c < outputs; ++c)
+    {
+        const double v = reference_auc(x, actual, n, outputs, c, outputs == 1 ? 1 : c);
+        if (v >= 0)
+        {
+            auc += v;
+            columns++;
+        }
+    }
+
+    genann_metrics *m = genann_evaluate(ann, threads, x, y, n);
+    if (!m)
+    {
+        printf("genann_evaluate failed, %d classes, n=%d\n", classes, n);
+        failures++;
+        free(actual);
+        return;
+    }
+
+    expect("accuracy", classes, n, count, m->accuracy, (double)correct / n, 0);
+    for (i = 0; i < classes * classes; ++i) expect("confusion", classes, n, count, m->confusion[i], confusion[i], 0);
+    expect("auc", classes, n, count, m->auc, columns ? auc / columns : -1, AUC_TOL);
+
+    genann_metrics_free(m);
+    free(actual);
+}
+
+
+int main(int argc, char *argv[])
+{
+    srand(argc > 1 ? atoi(argv[1]) : 1);
+
+    genann_real *x = malloc(sizeof(genann_real) * MAX_LENGTH * MAX_CLASSES);
+    genann_real *y = malloc(sizeof(genann_real) * MAX_LENGTH * MAX_CLASSES);
+    genann_threads *pool[MAX_THREADS + 1] = {0};
+    int outputs, t, n, i, k;
+
+    for (t = 1; t <= MAX_THREADS; ++t) pool[t] = genann_threads_create(t);
+
+    for (outputs = 1; outputs <= MAX_CLASSES; outputs += MAX_CLASSES - 1)
+    {
+        genann *ann = identity(outputs);
+
+        for (n = 1; n <= MAX_LENGTH; n += n < 20 ? 1 : 37)
+        {
+            /* Scores on a coarse grid, so many of them tie. */
+            for (i = 0; i < n; ++i)
+            {
+                const int label = rand() % (outputs == 1 ? 2 : outputs);
+                for (k = 0; k < outputs; ++k)
+                {
+                    x[i * outputs + k] = (genann_real)((rand() % 11) / 10.0);
+                    y[i * outputs + k] = outputs == 1 ? label : k == label;
+                }
+            }
+
+            check(ann, 0, x, y, n);
+            for (t = 1; t <= MAX_THREADS; ++t) check(ann, pool[t], x, y, n);
+
+            /* A NaN score, as from a diverged ann, must not hang the merge. */
+            if (n > 2)
+            {
+                x[(n / 2) * outputs] = (genann_real)NAN;
+                for (t = 0; t <= MAX_THREADS; ++t)
+                {
+                    genann_metrics *m = genann_evaluate(ann, pool[t], x, y, n);
+                    expect("auc with a NaN score", outputs == 1 ? 2 : outputs, n, t ? t : 1, m ? m->auc : 0, -1, 0);
+                    genann_metrics_free(m);
+                }
+            }
+        }
+
+        genann_free(ann);
+    }
+
+    for (t = 1; t <= MAX_THREADS; ++t) genann_threads_free(pool[t]);
+    free(x);
+    free(y);
+
+    printf("%s\n", failures ? "MISMATCH" : "ok");
+    return failures ? 1 : 0;
+}
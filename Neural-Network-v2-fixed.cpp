@@ -0,0 +1,116 @@
+/**
+ * @file Neural-Network-v2-fixed.cpp
+ * @brief Loads the weights exported by Neural-Network-v2-genann.c into a
+ * compile-time 8-3-1 network and compares it with genann_run on the
+ * pima-indians-diabetes test set, for agreement and latency.
+ * Usage: fixed [weights file], default Weights.txt.
+ */
+
+#include <chrono>
+#include <cstdio>
+
+#include "genann.h"
+#include "genann.hpp"
+
+#define NUM_OF_TESTING_OBSERVATIONS   168
+#define NUM_OF_FEATURES  8
+#define NUM_OF_HIDDEN_UNITS  3
+#define NUM_OF_OUTPUT_UNITS  1
+#define NUM_OF_REPEATS  20000
+
+/* One csv row: NUM_OF_FEATURES features followed by the label. */
+#define ROW_FORMAT "%" GENANN_SCN ",%" GENANN_SCN ",%" GENANN_SCN ",%" GENANN_SCN ",%" GENANN_SCN ",%" GENANN_SCN ",%" GENANN_SCN ",%" GENANN_SCN ",%" GENANN_SCN "\n"
+
+typedef genann_fixed::Network<NUM_OF_FEATURES, genann_fixed::Layers<NUM_OF_HIDDEN_UNITS>, NUM_OF_OUTPUT_UNITS> pima_net;
+
+
+static double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+int main(int argc, char *argv[])
+{
+    const char *weights_file = argc > 1 ? argv[1] : "Weights.txt";
+
+    static genann_real test_data[NUM_OF_TESTING_OBSERVATIONS][NUM_OF_FEATURES];
+    static genann_real test_label[NUM_OF_TESTING_OBSERVATIONS];
+
+    int i, r;
+
+/// ################################################## Load Test Data #######################################################
+    FILE *fp = fopen("pima-indians-diabetes_test.txt", "r");
+    if (fp == NULL)
+    {
+        printf("File Can not be opened !");
+        return 1;
+    }
+
+    for (i = 0; i < NUM_OF_TESTING_OBSERVATIONS; i++)
+    {
+        genann_real *d = test_data[i];
+        fscanf(fp, ROW_FORMAT, d, d+1, d+2, d+3, d+4, d+5, d+6, d+7, &test_label[i]);
+    }
+    fclose(fp);
+
+/// ################################################## Load Weights #########################################################
+    fp = fopen(weights_file, "r");
+    if (fp == NULL)
+    {
+        printf("Error loading ANN from file: %s.\n", weights_file);
+        return 1;
+    }
+    genann *ann = genann_read(fp);
+    fclose(fp);
+
+    pima_net net;
+    if (!net.load(ann))
+    {
+        printf("%s is not a %d-%d-%d network.\n", weights_file, NUM_OF_FEATURES, NUM_OF_HIDDEN_UNITS, NUM_OF_OUTPUT_UNITS);
+        genann_free(ann);
+        return 1;
+    }
+
+/// ################################################## Compare ##############################################################
+    int correct = 0, correct_fixed = 0;
+    double max_diff = 0;
+
+    for (i = 0; i < NUM_OF_TESTING_OBSERVATIONS; i++)
+    {
+        const double p = *genann_run(ann, test_data[i]);
+        const double pf = net.run(test_data[i])[0];
+        const double diff = p > pf ? p - pf : pf - p;
+
+        if (diff > max_diff) max_diff = diff;
+        if ((p > 0.5) == (test_label[i] > 0.5)) correct++;
+        if ((pf > 0.5) == (test_label[i] > 0.5)) correct_fixed++;
+    }
+
+    /* Sum the outputs so the timed loops can't be optimized away. */
+    double sink = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (r = 0; r < NUM_OF_REPEATS; r++)
+        for (i = 0; i < NUM_OF_TESTING_OBSERVATIONS; i++)
+            sink += *genann_run(ann, test_data[i]);
+    const double t_genann = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    for (r = 0; r < NUM_OF_REPEATS; r++)
+        for (i = 0; i < NUM_OF_TESTING_OBSERVATIONS; i++)
+            sink += net.run(test_data[i])[0];
+    const double t_fixed = seconds_since(start);
+
+    const double runs = (double)NUM_OF_REPEATS * NUM_OF_TESTING_OBSERVATIONS;
+
+    printf("Test Accuracy (genann): %lf\n", 100.0 * correct / NUM_OF_TESTING_OBSERVATIONS);
+    printf("Test Accuracy (fixed):  %lf\n", 100.0 * correct_fixed / NUM_OF_TESTING_OBSERVATIONS);
+    printf("Max output difference:  %g\n", max_diff);
+    printf("genann_run:   %.1f ns/observation\n", t_genann / runs * 1e9);
+    printf("fixed run:    %.1f ns/observation\n", t_fixed / runs * 1e9);
+    printf("(checksum %g)\n", sink);
+
+    genann_free(ann);
+    return 0;
+}
@@ -11,24 +11,47 @@
  */
 
 #include <stdio.h>
-#include <time.h>
+
+#include <stdlib.h>
 
 #include "genann.h"
+#include "genann_csv.h"
+#include "genann_parallel.h"
+#include "genann_norm.h"
+#include "genann_stop.h"
+#include "genann_eval.h"
 
 #define NUM_OF_TRAINING_OBSERVATIONS 600
+#define NUM_OF_VALIDATION_OBSERVATIONS 100
 #define NUM_OF_TESTING_OBSERVATIONS   168
 #define NUM_OF_FEATURES  8
-#define NUM_OF_ITERATIONS 1000
+#define NUM_OF_ITERATIONS 5000      /// upper bound; early stopping usually ends training sooner.
 #define LEARNING_RATE 0.001
+#define MOMENTUM 0.9
 #define NUM_OF_HIDDEN_LAYERS 1
 #define NUM_OF_HIDDEN_UNITS  3
 #define NUM_OF_OUTPUT_UNITS  1
+#define BATCH_SIZE  20
+#define NUM_OF_THREADS  1
+#define PATIENCE  50
+#define MIN_DELTA  1e-5
+
 
 
-void delay(unsigned int mseconds)
+void print_metrics(const char *name, genann_metrics const *m)
 {
-    clock_t goal = mseconds + clock();
-    while (goal > clock());
+    int a, p;
+    printf("\n%s Accuracy is: %lf\n", name, 100 * m->accuracy);
+    printf("%s Log Loss: %lf  MSE: %lf  ROC AUC: %lf\n", name, m->log_loss, m->mse, m->auc);
+
+    printf("Confusion matrix (rows: actual, columns: predicted):\n");
+    for (a = 0; a < m->classes; a++)
+    {
+        for (p = 0; p < m->classes; p++) printf(" %6ld", m->confusion[a * m->classes + p]);
+        printf("\n");
+    }
+    for (a = 0; a < m->classes; a++)
+        printf("Class %d: precision %lf, recall %lf\n", a, m->precision[a], m->recall[a]);
 }
 
 
@@ -39,59 +62,40 @@ int main(int argc, char *argv[])
    // printf("Train a small ANN to the XOR function using backpropagation.\n");
 
 
-    double  train_data[NUM_OF_TRAINING_OBSERVATIONS][NUM_OF_FEATURES];
-    double  train_label[NUM_OF_TRAINING_OBSERVATIONS];             /// true train values.
-    double test_data[NUM_OF_TESTING_OBSERVATIONS][NUM_OF_FEATURES];
-    double  test_label[NUM_OF_TESTING_OBSERVATIONS];             /// true test values.
-    double predicted_Train_label [NUM_OF_TRAINING_OBSERVATIONS];
-    double predicted_Test_label  [NUM_OF_TESTING_OBSERVATIONS];        /// predicted_Test_label  .
-
-
-    int i,j;
+    int i;
 
 /// ############################################### Preprocessing #########################################################
 
-/// ################################################### Load train_data #######################################################
-int row,column=0;
-
-FILE *fp;
-fp=fopen("pima-indians-diabetes.txt","r");
-
-if(fp!=NULL)
-{
-for(row=0;row<NUM_OF_TRAINING_OBSERVATIONS;row++)
-{
-    fscanf(fp,"%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf\n",&train_data[row][column],&train_data[row][column+1],&train_data[row][column+2],&train_data[row][column+3],&train_data[row][column+4],&train_data[row][column+5],&train_data[row][column+6],
-           &train_data[row][column+7],&train_label[row]);
-}
-
-fclose(fp);
-
-}
-else
-{
-printf("File Can not be opened !");
-
-}
-
-/// ################################################## Load Test Data #######################################################
-fp=fopen("pima-indians-diabetes_test.txt","r");
-column=0;
- if(fp!=NULL)
-{
-    for(row=0;row<NUM_OF_TESTING_OBSERVATIONS;row++)
-{
-            fscanf(fp,"%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf\n",&test_data[row][column],&test_data[row][column+1],&test_data[row][column+2],&test_data[row][column+3],&test_data[row][column+4],&test_data[row][column+5],&test_data[row][column+6],
-                   &test_data[row][column+7],&test_label[row]);
-}
-fclose(fp);
-}
+/// ################################################### Load train_data and test_data ########################################
+/* Each row: NUM_OF_FEATURES features, then the label in the last column. */
+    genann_threads *threads = genann_threads_create(NUM_OF_THREADS);
 
-else
-{
-printf("File Can not be opened !");
+    genann_csv *train = genann_csv_load("pima-indians-diabetes.txt", -1, ',', threads);
+    genann_csv *test = genann_csv_load("pima-indians-diabetes_test.txt", -1, ',', threads);
+    if (!train || !test || train->features != NUM_OF_FEATURES || test->features != NUM_OF_FEATURES)
+    {
+        printf("File Can not be opened !");
+        return 1;
+    }
 
-}
+    /* The rest of pima-indians-diabetes.txt is the test set; train on the first rows only.
+     * The last NUM_OF_VALIDATION_OBSERVATIONS of those are held out for early stopping. */
+    const int num_rows = train->rows < NUM_OF_TRAINING_OBSERVATIONS ? train->rows : NUM_OF_TRAINING_OBSERVATIONS;
+    const int num_valid = num_rows > 2 * NUM_OF_VALIDATION_OBSERVATIONS ? NUM_OF_VALIDATION_OBSERVATIONS : 0;
+    const int num_train = num_rows - num_valid;
+    const int num_test = test->rows;
+
+    genann_real const *train_data = train->data, *train_label = train->labels;
+    genann_real const *valid_data = train_data + (size_t)num_train * NUM_OF_FEATURES, *valid_label = train_label + num_train;
+    genann_real const *test_data = test->data, *test_label = test->labels;
+
+/// ################################################### Normalize ############################################################
+/* Standardize the training features; the features differ in scale by
+ * several orders of magnitude, which slows training down a lot. The
+ * statistics come from the training rows only and are folded into the
+ * first layer after training, so the test data stays raw. */
+    genann_norm *norm = genann_norm_fit(train->data, num_train, NUM_OF_FEATURES, GENANN_NORM_ZSCORE);
+    genann_norm_apply(norm, train->data, num_rows);
 
 /*
 int j;
@@ -101,7 +105,6 @@ for(i=0;i<NUM_OF_TESTING_OBSERVATIONS;i++)
 
     {
         printf("%lf \n",test_data[i][j]);
-           delay(1000);
     }
     //printf("\n #########################################################");
 }
@@ -113,63 +116,72 @@ for(i=0;i<NUM_OF_TESTING_OBSERVATIONS;i++)
      * and 1 output. */
     genann *ann = genann_init(NUM_OF_FEATURES, NUM_OF_HIDDEN_LAYERS, NUM_OF_HIDDEN_UNITS, NUM_OF_OUTPUT_UNITS);
 
-    /* Train on the four train_labeled train_data points many times. */
-    for (i = 0; i < NUM_OF_ITERATIONS; ++i)
-        {
+    /* Nesterov momentum converges several times faster than plain SGD here.
+     * Like realloc, on failure the old ann is still valid and still ours. */
+    genann *tuned = ann ? genann_set_optimizer(ann, GENANN_OPT_NESTEROV, MOMENTUM, 0) : 0;
+    if (!tuned)
+    {
+        printf("Could not create the ANN.\n");
+        genann_free(ann);
+        return 1;
+    }
+    ann = tuned;
 
-        for(j=0;j<NUM_OF_TRAINING_OBSERVATIONS;j++)
+    /* Train on the four train_labeled train_data points many times.
+     * Each mini-batch is split across NUM_OF_THREADS threads. Stops early once
+     * the validation loss hasn't improved for PATIENCE epochs. */
+    genann_stop *stop = genann_stop_init(PATIENCE, MIN_DELTA);
+    for (i = 0; i < NUM_OF_ITERATIONS; ++i)
         {
-            genann_train(ann, train_data[j], train_label + j, LEARNING_RATE);
+        genann_train_parallel(ann, threads, train_data, train_label, num_train,
+                              BATCH_SIZE, LEARNING_RATE, GENANN_PARALLEL_SYNC);
+        if (num_valid && genann_stop_update(stop, ann, genann_loss(ann, valid_data, valid_label, num_valid)) != 0)
+            break;
         }
 
-        }
-
-    /// ####################################### * Run the network and see what it predicts. */ ##########################;
-
-    for(i=0;i<NUM_OF_TESTING_OBSERVATIONS;i++)
-    {
-    predicted_Test_label  [i]=*genann_run(ann, test_data[i]);
-     printf("Output for test observation no: [%d] is [%1.f].\n", i, predicted_Test_label  [i]);
-
-    }
+    /* Keep the weights of the best epoch. */
+    if (genann_stop_restore(stop, ann) == 0)
+        printf("Trained %d epochs, best validation loss %lf at epoch %d.\n",
+               stop->epoch, stop->best_loss, stop->best_epoch);
+    genann_stop_free(stop);
 
     /// ################################################## Training Accuracy #########################################################
-    double counter=0;
-    for(i=0;i<NUM_OF_TRAINING_OBSERVATIONS;i++)
-    {
-    if(predicted_Train_label  [i]>0.5) predicted_Train_label  [i]=1;
-    else if(predicted_Train_label  [i]<0.5) predicted_Train_label  [i]=0;
-
-    if(predicted_Train_label  [i]==train_label[i])counter++;
-    printf("actual: [%lf] ,predicted: [%lf].\n",train_label[i],predicted_Train_label[i]);
-    }
+    /* The training rows are still normalized, so score them before folding. */
+    genann_metrics *train_metrics = genann_evaluate(ann, threads, train_data, train_label, num_train);
 
-    double training_accuracy=(counter/NUM_OF_TRAINING_OBSERVATIONS)*100 ;
+    /* From here on the network takes raw features, also in Weights.txt/bin. */
+    genann_norm_fold(norm, ann);
 
-    printf("\n\n\n Train Accuracy is: %lf ",training_accuracy);
-    delay(2000);
     /// ################################################## Testing Accuracy #########################################################
-    counter=0;
-    for(i=0;i<NUM_OF_TESTING_OBSERVATIONS;i++)
-    {
-    if(predicted_Test_label  [i]>0.5) predicted_Test_label  [i]=1;
-    else if(predicted_Test_label  [i]<0.5) predicted_Test_label  [i]=0;
+    genann_metrics *test_metrics = genann_evaluate(ann, threads, test_data, test_label, num_test);
 
-    if(predicted_Test_label  [i]==test_label[i])counter++;
-    printf("actual: [%lf] ,predicted: [%lf].\n",test_label[i],predicted_Test_label  [i]);
-    }
-
-    double accuracy=(counter/NUM_OF_TESTING_OBSERVATIONS)*100 ;
+    genann_threads_free(threads);
 
-    printf("\n\n\n  Test Accuracy is: %lf ",accuracy);
+    if (train_metrics) print_metrics("Train", train_metrics);
+    if (test_metrics) print_metrics("Test", test_metrics);
+    genann_metrics_free(train_metrics);
+    genann_metrics_free(test_metrics);
 
 /// ################################################ Export Weights ##############################################
 
 
-fp=fopen("Weights.txt","w");
+FILE *fp=fopen("Weights.txt","w");
 
     genann_write(ann,fp);
 fclose(fp);
+
+/* Same weights in the binary format, for loading with genann_map. */
+fp=fopen("Weights.bin","wb");
+if (!fp || genann_write_binary(ann,fp) != 0)
+        printf("\n Could not write Weights.bin");
+if (fp) fclose(fp);
+
+/* The folded norm, which the quantized network still needs for its inputs. */
+fp=fopen("Norm.txt","w");
+if (fp) genann_norm_write(norm,fp);
+else printf("\n Could not write Norm.txt");
+if (fp) fclose(fp);
+genann_norm_free(norm);
 /*
 FILE *fp2;
 fp2=fopen("Weights.txt","r");
@@ -212,6 +224,8 @@ double predicted_Test_label  2[NUM_OF_TESTING_OBSERVATIONS];
 
     fclose(fp2);
 */
+    genann_csv_free(train);
+    genann_csv_free(test);
     genann_free(ann);
     return 0;
 }
@@ -0,0 +1,117 @@
+/**
+ * @file Neural-Network-v2-quantize.c
+ * @brief Quantizes the weights exported by Neural-Network-v2-genann.c to 8 bits
+ * and reports the accuracy difference on the pima-indians-diabetes test set.
+ * Usage: quantize [weights file] [norm file], default Weights.txt and
+ * Norm.txt. Files ending in .bin are loaded with genann_map. Without a norm
+ * file the first layer keeps its inputs in full precision.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "genann.h"
+#include "genann_norm.h"
+#include "genann_quant.h"
+
+#define NUM_OF_TESTING_OBSERVATIONS   168
+#define NUM_OF_FEATURES  8
+
+/* One csv row: NUM_OF_FEATURES features followed by the label. */
+#define ROW_FORMAT "%" GENANN_SCN ",%" GENANN_SCN ",%" GENANN_SCN ",%" GENANN_SCN ",%" GENANN_SCN ",%" GENANN_SCN ",%" GENANN_SCN ",%" GENANN_SCN ",%" GENANN_SCN "\n"
+
+
+int main(int argc, char *argv[])
+{
+    const char *weights_file = argc > 1 ? argv[1] : "Weights.txt";
+    const char *norm_file = argc > 2 ? argv[2] : "Norm.txt";
+
+    genann_real test_data[NUM_OF_TESTING_OBSERVATIONS][NUM_OF_FEATURES];
+    genann_real test_label[NUM_OF_TESTING_OBSERVATIONS];
+
+    int i;
+
+/// ################################################## Load Test Data #######################################################
+    FILE *fp = fopen("pima-indians-diabetes_test.txt", "r");
+    if (fp == NULL)
+    {
+        printf("File Can not be opened !");
+        return 1;
+    }
+
+    for (i = 0; i < NUM_OF_TESTING_OBSERVATIONS; i++)
+    {
+        genann_real *r = test_data[i];
+        fscanf(fp, ROW_FORMAT, r, r+1, r+2, r+3, r+4, r+5, r+6, r+7, &test_label[i]);
+    }
+    fclose(fp);
+
+/// ################################################## Load and Quantize ####################################################
+    const size_t len = strlen(weights_file);
+    genann *ann;
+    if (len > 4 && strcmp(weights_file + len - 4, ".bin") == 0)
+    {
+        ann = genann_map(weights_file, GENANN_MAP_VERIFY);
+    }
+    else
+    {
+        fp = fopen(weights_file, "r");
+        if (fp == NULL)
+        {
+            printf("Error loading ANN from file: %s.\n", weights_file);
+            return 1;
+        }
+        ann = genann_read(fp);
+        fclose(fp);
+    }
+
+    /* The norm that was folded into the weights, if it was saved. */
+    genann_norm *norm = 0;
+    fp = fopen(norm_file, "r");
+    if (fp)
+    {
+        norm = genann_norm_read(fp);
+        fclose(fp);
+        if (!norm) printf("Could not read %s; first layer inputs stay full precision.\n", norm_file);
+    }
+
+    genann_q8 *q = ann ? genann_q8_quantize(ann, norm) : 0;
+    genann_norm_free(norm);
+    if (!q)
+    {
+        printf("Could not load or quantize ANN from file: %s.\n", weights_file);
+        return 1;
+    }
+
+/// ################################################## Compare ##############################################################
+    int correct = 0, correct_q = 0, agree = 0;
+    genann_real max_diff = 0;
+
+    for (i = 0; i < NUM_OF_TESTING_OBSERVATIONS; i++)
+    {
+        const genann_real p = *genann_run(ann, test_data[i]);
+        const genann_real pq = *genann_q8_run(q, test_data[i]);
+        const genann_real diff = p > pq ? p - pq : pq - p;
+
+        if (diff > max_diff) max_diff = diff;
+        if ((p > 0.5) == (test_label[i] > 0.5)) correct++;
+        if ((pq > 0.5) == (test_label[i] > 0.5)) correct_q++;
+        if ((p > 0.5) == (pq > 0.5)) agree++;
+    }
+
+    const double accuracy = 100.0 * correct / NUM_OF_TESTING_OBSERVATIONS;
+    const double accuracy_q = 100.0 * correct_q / NUM_OF_TESTING_OBSERVATIONS;
+
+    printf("Weights: %d x %d bytes -> %d x 1 byte (+ %d scales and biases)\n",
+           ann->total_weights, (int)sizeof(genann_real), q->total_weights, 2 * (q->total_neurons - q->inputs));
+    printf("Test Accuracy (full precision): %lf\n", accuracy);
+    printf("Test Accuracy (int8):           %lf\n", accuracy_q);
+    printf("Accuracy difference:            %+lf\n", accuracy_q - accuracy);
+    printf("Predictions in agreement:       %d / %d\n", agree, NUM_OF_TESTING_OBSERVATIONS);
+    printf("Max output difference:          %g\n", (double)max_diff);
+
+    genann_q8_free(q);
+    genann_free(ann);
+    return 0;
+}
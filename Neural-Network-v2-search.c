@@ -0,0 +1,126 @@
+/**
+ * @file Neural-Network-v2-search.c
+ * @brief Tunes the v2 network on pima-indians-diabetes instead of editing
+ * the #defines of Neural-Network-v2-genann.c: trains a grid of topologies,
+ * learning rates and batch sizes at once on a thread pool, prunes the ones
+ * that lag by successive halving, and prints the leaderboard and the test
+ * accuracy of the best model and of an ensemble of the best few.
+ * Usage: search [threads] [random configs], default all cores and the full grid.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "genann.h"
+#include "genann_csv.h"
+#include "genann_norm.h"
+#include "genann_eval.h"
+#include "genann_search.h"
+
+#define NUM_OF_TRAINING_OBSERVATIONS 600
+#define NUM_OF_VALIDATION_OBSERVATIONS 100
+#define NUM_OF_FEATURES  8
+#define MIN_EPOCHS  10
+#define MAX_EPOCHS  270
+#define ETA  3
+#define MOMENTUM 0.9
+#define ENSEMBLE_SIZE  5
+#define LEADERBOARD_SIZE  10
+#define SEED  1
+
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+int main(int argc, char *argv[])
+{
+    const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    const int num_threads = argc > 1 ? atoi(argv[1]) : (cores > 0 ? (int)cores : 1);
+    const int num_random = argc > 2 ? atoi(argv[2]) : 0;
+
+    static const int hidden_layers[] = {1, 2};
+    static const int hidden[] = {2, 3, 5, 8, 16};
+    static const double learning_rate[] = {0.0003, 0.001, 0.003, 0.01};
+    static const int batch[] = {10, 20, 50};
+    static const int optimizer[] = {GENANN_OPT_NESTEROV, GENANN_OPT_ADAM};
+    const genann_space space = {
+        hidden_layers, 2, hidden, 5, learning_rate, 4, batch, 3, optimizer, 2
+    };
+    const genann_search_options options = {MIN_EPOCHS, MAX_EPOCHS, ETA, MOMENTUM, SEED};
+
+    genann_threads *threads = genann_threads_create(num_threads > 0 ? num_threads : 1);
+    genann_csv *train = genann_csv_load("pima-indians-diabetes.txt", -1, ',', threads);
+    genann_csv *test = genann_csv_load("pima-indians-diabetes_test.txt", -1, ',', threads);
+    if (!threads || !train || !test || train->features != NUM_OF_FEATURES || test->features != NUM_OF_FEATURES)
+    {
+        printf("File Can not be opened !");
+        return 1;
+    }
+
+    /* Same split as the v2 driver: the rest of the train file is the test set,
+     * and the last training rows are held out to rank the candidates. */
+    const int num_rows = train->rows < NUM_OF_TRAINING_OBSERVATIONS ? train->rows : NUM_OF_TRAINING_OBSERVATIONS;
+    const int num_valid = NUM_OF_VALIDATION_OBSERVATIONS;
+    const int num_train = num_rows - num_valid;
+
+    genann_norm *norm = genann_norm_fit(train->data, num_train, NUM_OF_FEATURES, GENANN_NORM_ZSCORE);
+    genann_norm_apply(norm, train->data, num_rows);
+    genann_norm_apply(norm, test->data, test->rows);
+    genann_norm_free(norm);
+
+    int count, i;
+    genann_config *configs = num_random > 0 ? genann_space_sample(&space, count = num_random, SEED)
+                                            : genann_space_grid(&space, &count);
+
+/// ################################################### Search ###############################################################
+    const double start = now();
+    genann_search *search = genann_search_run(NUM_OF_FEATURES, 1, configs, count,
+            train->data, train->labels, num_train,
+            train->data + (size_t)num_train * NUM_OF_FEATURES, train->labels + num_train, num_valid,
+            threads, &options);
+    const double seconds = now() - start;
+    free(configs);
+
+    if (!search)
+    {
+        printf("Search failed.\n");
+        return 1;
+    }
+
+    printf("%d candidates, %d rungs, %d threads: %.3f s\n\n", count, search->rungs, genann_threads_count(threads), seconds);
+    printf("rank  layers hidden  rate      batch optimizer  epochs  valid_mse  test_acc  test_auc\n");
+    for (i = 0; i < search->count && i < LEADERBOARD_SIZE; i++)
+    {
+        genann_candidate const *c = search->candidate + i;
+        genann_metrics *m = genann_evaluate(c->ann, threads, test->data, test->labels, test->rows);
+        printf("%4d  %6d %6d  %-9.3g %5d %-9s  %6d  %9.6f  %8.3f  %8.4f\n", i + 1,
+               c->config.hidden_layers, c->config.hidden, c->config.learning_rate, c->config.batch,
+               c->config.optimizer == GENANN_OPT_ADAM ? "adam" : "nesterov",
+               c->epochs, c->loss, m ? 100 * m->accuracy : 0, m ? m->auc : 0);
+        genann_metrics_free(m);
+    }
+
+/// ################################################## Ensemble ##############################################################
+    genann_real *predicted = malloc(sizeof(genann_real) * test->rows);
+    if (predicted && genann_search_ensemble(search, ENSEMBLE_SIZE, test->data, test->rows, predicted) == 0)
+    {
+        int correct = 0;
+        for (i = 0; i < test->rows; i++)
+            if ((predicted[i] > 0.5) == (test->labels[i] > 0.5)) correct++;
+        printf("\nEnsemble of the best %d: Test Accuracy is: %lf\n", ENSEMBLE_SIZE, 100.0 * correct / test->rows);
+    }
+    free(predicted);
+
+    genann_search_free(search);
+    genann_csv_free(train);
+    genann_csv_free(test);
+    genann_threads_free(threads);
+    return 0;
+}
@@ -0,0 +1,183 @@
+/**
+ * @file Neural-Network-v2-simdcheck.c
+ * @brief Checks every SIMD level this CPU supports against the scalar
+ * reference kernels, on random data and every length up to MAX_LENGTH.
+ * Exits nonzero if any kernel differs by more than its tolerance.
+ * Usage: simdcheck [seed], default 1.
+ */
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "genann.h"
+#include "genann_simd.h"
+
+#define MAX_LENGTH  200
+#define LONG_LENGTH  4099
+
+/* Tolerances, in units of the machine epsilon of genann_real.
+ * Reductions may be summed in any order, so their error grows with the length
+ * and is measured against sum |a[k] * b[k]|. Elementwise kernels may fuse a
+ * multiply and add, so they get a few rounding errors per element. */
+#ifdef GENANN_FLOAT
+#define EPS FLT_EPSILON
+#else
+#define EPS DBL_EPSILON
+#endif
+#define DOT_TOL(n)  (2.0 * ((n) + 1) * EPS)
+#define ELEMENT_TOL  (8 * EPS)
+/* The vector sigmoid uses a polynomial exp good to the last bit or two. */
+#define SIGMOID_TOL  (16 * EPS)
+
+static const char *level_name[] = {"scalar", "sse2", "avx2", "avx512"};
+
+static int failures = 0;
+
+
+static double uniform(double lo, double hi)
+{
+    return lo + (hi - lo) * rand() / (double)RAND_MAX;
+}
+
+
+static void fill(genann_real *x, int n, double lo, double hi)
+{
+    int k;
+    for (k = 0; k < n; ++k) x[k] = (genann_real)uniform(lo, hi);
+}
+
+
+/* Reports a mismatch when |got - want| > tol * scale, or when only one of
+ * them is NaN. */
+static void expect(int level, const char *kernel, int n, double got, double want, double tol, double scale)
+{
+    const double err = want != want && got != got ? 0 : fabs(got - want);
+    if (!(err <= tol * (scale > 1e-300 ? scale : 1)))
+    {
+        if (failures < 20)
+            printf("%s %s n=%d: got %.17g, scalar %.17g, error %g > %g\n",
+                   level_name[level], kernel, n, got, want, err, tol * scale);
+        failures++;
+    }
+}
+
+
+static void check_length(int level, int n)
+{
+    genann_real *a = malloc(sizeof(genann_real) * (n + 1) * 16);
+    genann_real *b = a + (n + 1), *w1 = b + (n + 1), *w2 = w1 + (n + 1), *w3 = w2 + (n + 1);
+    genann_real *y = w3 + (n + 1), *yref = y + (n + 1);
+    genann_real *m = yref + (n + 1), *v = m + (n + 1), *mref = v + (n + 1), *vref = mref + (n + 1);
+    genann_real *wref = vref + (n + 1), *s = wref + (n + 1), *sref = s + (n + 1);
+    signed char *q1 = malloc(n + 1), *q2 = malloc(n + 1);
+    genann_kernels vec, ref;
+    int k;
+
+    genann_simd_select(GENANN_SIMD_SCALAR);
+    ref = genann_kern;
+    genann_simd_select(level);
+    vec = genann_kern;
+
+    fill(a, n, -1, 1); fill(b, n, -1, 1);
+    fill(w1, n, -1, 1); fill(w2, n, -1, 1); fill(w3, n, -1, 1);
+
+    double scale[4] = {0, 0, 0, 0};
+    for (k = 0; k < n; ++k)
+    {
+        scale[0] += fabs(a[k] * b[k]);
+        scale[1] += fabs(w1[k] * b[k]);
+        scale[2] += fabs(w2[k] * b[k]);
+        scale[3] += fabs(w3[k] * b[k]);
+    }
+
+    /* dot, dot4 */
+    expect(level, "dot", n, vec.dot(a, b, n), ref.dot(a, b, n), DOT_TOL(n), scale[0]);
+
+    genann_real out[4], out_ref[4];
+    vec.dot4(a, w1, w2, w3, b, n, out);
+    ref.dot4(a, w1, w2, w3, b, n, out_ref);
+    for (k = 0; k < 4; ++k) expect(level, "dot4", n, out[k], out_ref[k], DOT_TOL(n), scale[k]);
+
+    /* axpy */
+    fill(y, n, -1, 1);
+    memcpy(yref, y, sizeof(genann_real) * n);
+    vec.axpy((genann_real)0.37, a, y, n);
+    ref.axpy((genann_real)0.37, a, yref, n);
+    for (k = 0; k < n; ++k) expect(level, "axpy", n, y[k], yref[k], ELEMENT_TOL, fabs(yref[k]) + fabs(0.37 * a[k]));
+
+    /* dot_s8, exact; the extremes check the 32-bit accumulation. */
+    for (k = 0; k < n; ++k)
+    {
+        q1[k] = (signed char)(rand() % 256 - 128);
+        q2[k] = k % 7 == 0 ? -128 : (signed char)(rand() % 256 - 128);
+    }
+    expect(level, "dot_s8", n, vec.dot_s8(q1, q2, n), ref.dot_s8(q1, q2, n), 0, 1);
+
+    /* sigmoid, over and past the saturation range; NaN must stay NaN. */
+    fill(s, n, -60, 60);
+    for (k = 0; k < n; k += 5) s[k] = (genann_real)uniform(-2, 2);
+    for (k = 3; k < n; k += 11) s[k] = k % 3 == 0 ? (genann_real)NAN : k % 3 == 1 ? (genann_real)INFINITY : -(genann_real)INFINITY;
+    memcpy(sref, s, sizeof(genann_real) * n);
+    vec.sigmoid(s, n);
+    ref.sigmoid(sref, n);
+    for (k = 0; k < n; ++k) expect(level, "sigmoid", n, s[k], sref[k], SIGMOID_TOL, 1);
+
+    /* momentum and Nesterov. */
+    int nesterov;
+    for (nesterov = 0; nesterov < 2; ++nesterov)
+    {
+        fill(y, n, -1, 1); fill(v, n, -0.1, 0.1);
+        memcpy(yref, y, sizeof(genann_real) * n);
+        memcpy(vref, v, sizeof(genann_real) * n);
+        vec.momentum(y, v, a, (genann_real)0.9, (genann_real)0.01, nesterov, n);
+        ref.momentum(yref, vref, a, (genann_real)0.9, (genann_real)0.01, nesterov, n);
+        for (k = 0; k < n; ++k)
+        {
+            expect(level, nesterov ? "nesterov v" : "momentum v", n, v[k], vref[k], ELEMENT_TOL, fabs(vref[k]) + 0.01);
+            expect(level, nesterov ? "nesterov w" : "momentum w", n, y[k], yref[k], ELEMENT_TOL, fabs(yref[k]) + 0.2);
+        }
+    }
+
+    /* adam */
+    fill(y, n, -1, 1); fill(m, n, -0.1, 0.1); fill(v, n, 0, 0.01);
+    memcpy(wref, y, sizeof(genann_real) * n);
+    memcpy(mref, m, sizeof(genann_real) * n);
+    memcpy(vref, v, sizeof(genann_real) * n);
+    vec.adam(y, m, v, a, (genann_real)0.9, (genann_real)0.999, (genann_real)0.001, (genann_real)1e-8, n);
+    ref.adam(wref, mref, vref, a, (genann_real)0.9, (genann_real)0.999, (genann_real)0.001, (genann_real)1e-8, n);
+    for (k = 0; k < n; ++k)
+    {
+        expect(level, "adam m", n, m[k], mref[k], ELEMENT_TOL, fabs(mref[k]) + 0.1);
+        expect(level, "adam v", n, v[k], vref[k], ELEMENT_TOL, fabs(vref[k]) + 1e-3);
+        expect(level, "adam w", n, y[k], wref[k], ELEMENT_TOL, fabs(wref[k]) + 0.01);
+    }
+
+    free(q1);
+    free(q2);
+    free(a);
+}
+
+
+int main(int argc, char *argv[])
+{
+    srand(argc > 1 ? atoi(argv[1]) : 1);
+
+    const int best = genann_simd_detect();
+    int level, n;
+
+    for (level = GENANN_SIMD_SSE2; level <= best; ++level)
+    {
+        const int before = failures;
+        for (n = 0; n <= MAX_LENGTH; ++n) check_length(level, n);
+        check_length(level, LONG_LENGTH);
+        printf("%-7s %s\n", level_name[level], failures == before ? "ok" : "MISMATCH");
+    }
+
+    if (best == GENANN_SIMD_SCALAR) printf("No SIMD level supported; nothing to check.\n");
+
+    genann_simd_select(best);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,97 @@
+/**
+ * @file Neural-Network-v2-stream.c
+ * @brief Trains the v2 network on a csv file of any size without loading it,
+ * streaming it in chunks read by a background thread, and reports how long
+ * training stalled waiting on I/O.
+ * Usage: stream [train file] [test file] [epochs] [chunk rows],
+ * default pima-indians-diabetes.txt, pima-indians-diabetes_test.txt, 1000, 4096.
+ * The label is the last column.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "genann.h"
+#include "genann_csv.h"
+#include "genann_parallel.h"
+
+#define LEARNING_RATE 0.001
+#define NUM_OF_HIDDEN_LAYERS 1
+#define NUM_OF_HIDDEN_UNITS  3
+#define NUM_OF_OUTPUT_UNITS  1
+#define BATCH_SIZE  20
+#define NUM_OF_THREADS  1
+#define SHUFFLE_SEED  1
+
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+int main(int argc, char *argv[])
+{
+    const char *train_file = argc > 1 ? argv[1] : "pima-indians-diabetes.txt";
+    const char *test_file = argc > 2 ? argv[2] : "pima-indians-diabetes_test.txt";
+    const int epochs = argc > 3 ? atoi(argv[3]) : 1000;
+    const int chunk_rows = argc > 4 ? atoi(argv[4]) : 4096;
+
+    genann_csv_stream *stream = genann_csv_stream_open(train_file, -1, ',', chunk_rows, SHUFFLE_SEED);
+    if (!stream)
+    {
+        printf("File Can not be opened: %s\n", train_file);
+        return 1;
+    }
+
+    genann *ann = genann_init(genann_csv_stream_features(stream), NUM_OF_HIDDEN_LAYERS, NUM_OF_HIDDEN_UNITS, NUM_OF_OUTPUT_UNITS);
+    genann_threads *threads = genann_threads_create(NUM_OF_THREADS);
+
+/// ################################################### Train ################################################################
+    long observations = 0;
+    int i;
+    const double start = now();
+
+    for (i = 0; i < epochs; ++i)
+    {
+        const long n = genann_train_stream(ann, threads, stream, BATCH_SIZE, LEARNING_RATE, GENANN_PARALLEL_SYNC);
+        if (n < 0)
+        {
+            printf("Error reading %s\n", train_file);
+            return 1;
+        }
+        observations += n;
+    }
+
+    const double seconds = now() - start;
+    const double stall = genann_csv_stream_stall(stream);
+
+    printf("Trained %d epochs, %ld observations in %.3f s (%.0f observations/s)\n",
+           epochs, observations, seconds, observations / seconds);
+    printf("Stalled on I/O: %.3f s (%.1f%% of training time)\n", stall, seconds > 0 ? 100 * stall / seconds : 0.0);
+
+    genann_csv_stream_close(stream);
+
+/// ################################################## Test ##################################################################
+    genann_csv *test = genann_csv_load(test_file, -1, ',', threads);
+    if (test && test->features == ann->inputs)
+    {
+        genann_real *predicted = malloc(sizeof(genann_real) * test->rows);
+        genann_run_batch(ann, test->data, test->rows, predicted);
+
+        int correct = 0;
+        for (i = 0; i < test->rows; ++i)
+            if ((predicted[i] > 0.5) == (test->labels[i] > 0.5)) correct++;
+
+        printf("Test Accuracy is: %lf\n", 100.0 * correct / test->rows);
+        free(predicted);
+    }
+    genann_csv_free(test);
+
+    genann_threads_free(threads);
+    genann_free(ann);
+    return 0;
+}
@@ -24,111 +24,379 @@
  */
 
 #include "genann.h"
+#include "genann_simd.h"
 
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <assert.h>
 #include <stdio.h>
+#include <stdint.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define GENANN_HAVE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 #define LOOKUP_SIZE 4096
+#define LOOKUP_MIN -15.0
+#define LOOKUP_MAX 15.0
+#define LOOKUP_INTERVAL ((LOOKUP_MAX - LOOKUP_MIN) / LOOKUP_SIZE)
+
+#ifdef GENANN_FLOAT
+#define GENANN_EXP expf
+#define GENANN_TANH tanhf
+#else
+#define GENANN_EXP exp
+#define GENANN_TANH tanh
+#endif
+
+/* Number of observations pushed through a layer together by the batch routines. */
+#define BATCH_BLOCK 64
 
-double genann_act_sigmoid(double a) {
+
+genann_real genann_act_sigmoid(genann_real a) {
     if (a < -45.0) return 0;
     if (a > 45.0) return 1;
-    return 1.0 / (1 + exp(-a));
-}
-
-
-double genann_act_sigmoid_cached(double a) {
-    /* If you're optimizing for memory usage, just
-     * delete this entire function and replace references
-     * of genann_act_sigmoid_cached to genann_act_sigmoid
-     */
-    const double min = -15.0;
-    const double max = 15.0;
-    static double interval;
-    static int initialized = 0;
-    static double lookup[LOOKUP_SIZE];
-
-    /* Calculate entire lookup table on first run. */
-    if (!initialized) {
-        interval = (max - min) / LOOKUP_SIZE;
-        int i;
-        for (i = 0; i < LOOKUP_SIZE; ++i) {
-            lookup[i] = genann_act_sigmoid(min + interval * i);
-        }
-        /* This is down here to make this thread safe. */
-        initialized = 1;
-    }
+    return 1 / (1 + GENANN_EXP(-a));
+}
+
+
+/* If you're optimizing for memory usage, just delete the lookup table and
+ * map GENANN_ACT_SIGMOID_CACHED to genann_act_sigmoid. */
+static genann_real lookup[LOOKUP_SIZE];
 
+
+/* Fills the sigmoid lookup table. It runs once, before main on compilers with
+ * constructor support and from genann_init otherwise, so lookups never race
+ * with initialization and the first call pays no extra latency. */
+static void genann_init_sigmoid_lookup(void) {
     int i;
-    i = (int)((a-min)/interval+0.5);
+    for (i = 0; i < LOOKUP_SIZE; ++i) {
+        lookup[i] = genann_act_sigmoid(LOOKUP_MIN + LOOKUP_INTERVAL * i);
+    }
+}
+
+#ifdef __GNUC__
+__attribute__((constructor))
+static void genann_startup(void) {
+    genann_init_sigmoid_lookup();
+}
+#endif
+
+
+genann_real genann_act_sigmoid_cached(genann_real a) {
+    /* NaN fails both range checks; pass it through like genann_act_sigmoid
+     * so a diverged ann shows up instead of indexing out of the table. */
+    if (a != a) return a;
+
+    /* Clamp first so huge inputs can't overflow the index. */
+    if (a < LOOKUP_MIN) return lookup[0];
+    if (a > LOOKUP_MAX) return lookup[LOOKUP_SIZE-1];
+
+    const int i = (int)((a - LOOKUP_MIN) / LOOKUP_INTERVAL + 0.5);
     if (i <= 0) return lookup[0];
     if (i >= LOOKUP_SIZE) return lookup[LOOKUP_SIZE-1];
     return lookup[i];
 }
 
 
-double genann_act_threshold(double a) {
+genann_real genann_act_threshold(genann_real a) {
     return a > 0;
 }
 
 
-double genann_act_linear(double a) {
+genann_real genann_act_linear(genann_real a) {
     return a;
 }
 
 
-genann *genann_init(int inputs, int hidden_layers, int hidden, int outputs) {
-    if (hidden_layers < 0) return 0;
-    if (inputs < 1) return 0;
-    if (outputs < 1) return 0;
-    if (hidden_layers > 0 && hidden < 1) return 0;
+genann_real genann_act_tanh(genann_real a) {
+    return GENANN_TANH(a);
+}
 
 
-    const int hidden_weights = hidden_layers ? (inputs+1) * hidden + (hidden_layers-1) * (hidden+1) * hidden : 0;
-    const int output_weights = (hidden_layers ? (hidden+1) : (inputs+1)) * outputs;
-    const int total_weights = (hidden_weights + output_weights);
+genann_real genann_act_relu(genann_real a) {
+    return a > 0 ? a : 0;
+}
 
-    const int total_neurons = (inputs + hidden * hidden_layers + outputs);
 
-    /* Allocate extra size for weights, outputs, and deltas. */
-    const int size = sizeof(genann) + sizeof(double) * (total_weights + total_neurons + (total_neurons - inputs));
-    genann *ret = malloc(size);
-    if (!ret) return 0;
+void genann_act_layer(int activation, genann_real *x, int n) {
+    int k;
+    switch (activation) {
+        case GENANN_ACT_SIGMOID:
+            genann_kern.sigmoid(x, n);
+            break;
+
+        case GENANN_ACT_SIGMOID_CACHED:
+            for (k = 0; k < n; ++k) x[k] = genann_act_sigmoid_cached(x[k]);
+            break;
+
+        case GENANN_ACT_THRESHOLD:
+            for (k = 0; k < n; ++k) x[k] = x[k] > 0;
+            break;
+
+        case GENANN_ACT_TANH:
+            /* Not 2 * sigmoid(2a) - 1, which cancels near 0. */
+            for (k = 0; k < n; ++k) x[k] = GENANN_TANH(x[k]);
+            break;
+
+        case GENANN_ACT_RELU:
+            for (k = 0; k < n; ++k) x[k] = x[k] > 0 ? x[k] : 0;
+            break;
+
+        case GENANN_ACT_LINEAR:
+            break;
 
-    ret->inputs = inputs;
+        default:
+            /* genann_set_activation and the readers only accept known ids. */
+            assert(0 && "unknown activation");
+            break;
+    }
+}
+
+
+void genann_act_layer_derivative(int activation, genann_real const *y, genann_real *d, int n) {
+    int k;
+    switch (activation) {
+        case GENANN_ACT_SIGMOID:
+        case GENANN_ACT_SIGMOID_CACHED:
+            for (k = 0; k < n; ++k) d[k] *= y[k] * (1 - y[k]);
+            break;
+
+        case GENANN_ACT_THRESHOLD:
+            /* Flat everywhere; y * (1 - y) is zero for its outputs too. */
+            for (k = 0; k < n; ++k) d[k] = 0;
+            break;
+
+        case GENANN_ACT_TANH:
+            for (k = 0; k < n; ++k) d[k] *= 1 - y[k] * y[k];
+            break;
+
+        case GENANN_ACT_RELU:
+            for (k = 0; k < n; ++k) d[k] = y[k] > 0 ? d[k] : 0;
+            break;
+
+        case GENANN_ACT_LINEAR:
+            break;
+
+        default:
+            /* genann_set_activation and the readers only accept known ids. */
+            assert(0 && "unknown activation");
+            break;
+    }
+}
+
+
+int genann_activation_valid(int activation) {
+    return activation >= GENANN_ACT_SIGMOID && activation <= GENANN_ACT_RELU;
+}
+
+
+int genann_set_activation(genann *ann, int hidden, int output) {
+    if (!genann_activation_valid(hidden) || !genann_activation_valid(output)) return -1;
+    ann->activation_hidden = hidden;
+    ann->activation_output = output;
+    return 0;
+}
+
+
+/* Number of total_weights long state buffers each optimizer keeps. */
+static int genann_moments(int optimizer) {
+    switch (optimizer) {
+        case GENANN_OPT_MOMENTUM:
+        case GENANN_OPT_NESTEROV: return 1;
+        case GENANN_OPT_ADAM: return 2;
+        default: return 0;
+    }
+}
+
+
+/* Bytes from the start of an ann's block to its weights: the struct, the
+ * update counter and the tables, rounded up to a cache line so the weights
+ * of a 64-byte aligned block are too. */
+static size_t genann_tables_size(int layers) {
+    return (sizeof(genann) + sizeof(long) + sizeof(int) * 3 * (layers + 1) + 63) / 64 * 64;
+}
+
+
+static void genann_totals(int layers, int const *width, int *total_weights, int *total_neurons) {
+    int l;
+    *total_weights = 0;
+    *total_neurons = width[0];
+    for (l = 1; l < layers; ++l) {
+        *total_weights += (width[l-1] + 1) * width[l];
+        *total_neurons += width[l];
+    }
+}
+
+
+/* Size of the block genann_place lays out. */
+static size_t genann_block_size(int layers, int const *width, int with_weights, int with_scratch, int moments) {
+    int total_weights, total_neurons;
+    genann_totals(layers, width, &total_weights, &total_neurons);
+
+    /* Extra size for weights, optimizer state, outputs, and deltas. */
+    const size_t scratch = with_scratch ? total_neurons + (total_neurons - width[0]) : 0;
+    const size_t state = (size_t)moments * total_weights;
+    return genann_tables_size(layers) + sizeof(genann_real) * ((with_weights ? total_weights : 0) + state + scratch);
+}
+
+
+/* Lays out an ann with the given layer widths in block, which holds
+ * genann_block_size bytes, and fills in the width and offset tables. The
+ * weights are left unset, and left out of the block entirely unless
+ * with_weights is set; output and delta are only there if with_scratch is
+ * set. moments optimizer state buffers follow the weights, zeroed. */
+static genann *genann_place(void *block, int layers, int const *width, int with_weights, int with_scratch, int moments) {
+    const int hidden_layers = layers - 2;
+
+    int l, total_weights, total_neurons, hidden = 0;
+    genann_totals(layers, width, &total_weights, &total_neurons);
+    for (l = 1; l < layers - 1; ++l) {
+        if (width[l] > hidden) hidden = width[l];
+    }
+
+    const size_t tables = genann_tables_size(layers);
+    const size_t state = (size_t)moments * total_weights;
+    genann *ret = block;
+
+    ret->inputs = width[0];
     ret->hidden_layers = hidden_layers;
     ret->hidden = hidden;
-    ret->outputs = outputs;
+    ret->outputs = width[layers - 1];
 
     ret->total_weights = total_weights;
     ret->total_neurons = total_neurons;
 
+    /* Fill in the tables; both offset tables end with the totals. */
+    ret->step = (long*)((char*)ret + sizeof(genann));
+    ret->width = (int*)(ret->step + 1);
+    ret->neuron_offset = ret->width + layers + 1;
+    ret->weight_offset = ret->neuron_offset + layers + 1;
+
+    ret->width[layers] = 0;
+    ret->neuron_offset[0] = 0;
+    ret->weight_offset[0] = ret->weight_offset[1] = 0;
+    for (l = 0; l < layers; ++l) {
+        ret->width[l] = width[l];
+        ret->neuron_offset[l+1] = ret->neuron_offset[l] + width[l];
+        if (l) ret->weight_offset[l+1] = ret->weight_offset[l] + (width[l-1] + 1) * width[l];
+    }
+
     /* Set pointers. */
-    ret->weight = (double*)((char*)ret + sizeof(genann));
-    ret->output = ret->weight + ret->total_weights;
-    ret->delta = ret->output + ret->total_neurons;
+    genann_real *next = (genann_real*)((char*)ret + tables);
+    ret->weight = with_weights ? next : 0;
+    if (with_weights) next += total_weights;
+    ret->moment = moments ? next : 0;
+    next += state;
+    ret->output = with_scratch ? next : 0;
+    ret->delta = with_scratch ? next + total_neurons : 0;
+
+    ret->mapping = 0;
+    ret->mapping_size = 0;
+    ret->pool = 0;
+
+    ret->activation_hidden = GENANN_ACT_SIGMOID_CACHED;
+    ret->activation_output = GENANN_ACT_SIGMOID_CACHED;
+
+    ret->optimizer = GENANN_OPT_SGD;
+    ret->beta1 = ret->beta2 = 0;
+    ret->epsilon = 1e-8;
+    *ret->step = 0;
+    if (state) memset(ret->moment, 0, sizeof(genann_real) * state);
+
+    return ret;
+}
+
+
+/* Allocates and lays out an ann; see genann_place. */
+static genann *genann_alloc(int layers, int const *width, int with_weights, int with_scratch, int moments) {
+    void *block = malloc(genann_block_size(layers, width, with_weights, with_scratch, moments));
+    if (!block) return 0;
+    return genann_place(block, layers, width, with_weights, with_scratch, moments);
+}
+
+
+genann *genann_init_layers(int layers, int const *width) {
+    if (layers < 2) return 0;
+
+    int l;
+    for (l = 0; l < layers; ++l) {
+        if (width[l] < 1) return 0;
+    }
+
+#ifndef __GNUC__
+    genann_init_sigmoid_lookup();
+#endif
+
+    genann *ret = genann_alloc(layers, width, 1, 1, 0);
+    if (!ret) return 0;
 
     genann_randomize(ret);
 
-    ret->activation_hidden = genann_act_sigmoid_cached;
-    ret->activation_output = genann_act_sigmoid_cached;
+    return ret;
+}
+
+
+genann *genann_init(int inputs, int hidden_layers, int hidden, int outputs) {
+    if (hidden_layers < 0) return 0;
+    if (inputs < 1) return 0;
+    if (outputs < 1) return 0;
+    if (hidden_layers > 0 && hidden < 1) return 0;
+
+    int *width = malloc(sizeof(int) * (hidden_layers + 2));
+    if (!width) return 0;
+
+    int l;
+    width[0] = inputs;
+    for (l = 1; l <= hidden_layers; ++l) width[l] = hidden;
+    width[hidden_layers + 1] = outputs;
+
+    genann *ret = genann_init_layers(hidden_layers + 2, width);
+    free(width);
 
     return ret;
 }
 
 
+/* Returns 1 if every hidden layer of ann has the same width. */
+static int genann_uniform(genann const *ann) {
+    int l;
+    for (l = 2; l <= ann->hidden_layers; ++l) {
+        if (ann->width[l] != ann->width[1]) return 0;
+    }
+    return 1;
+}
+
+
 genann *genann_read(FILE *in) {
     int inputs, hidden_layers, hidden, outputs;
-    fscanf(in, "%d %d %d %d", &inputs, &hidden_layers, &hidden, &outputs);
+    if (fscanf(in, "%d %d %d %d", &inputs, &hidden_layers, &hidden, &outputs) != 4) return 0;
+    if (hidden_layers < 0) return 0;
 
-    genann *ann = genann_init(inputs, hidden_layers, hidden, outputs);
+    int *width = malloc(sizeof(int) * (hidden_layers + 2));
+    if (!width) return 0;
+
+    /* A negative hidden width means each hidden layer's width follows. */
+    int l;
+    width[0] = inputs;
+    for (l = 1; l <= hidden_layers; ++l) {
+        width[l] = hidden;
+        if (hidden < 0 && fscanf(in, "%d", width + l) != 1) width[l] = 0;
+    }
+    width[hidden_layers + 1] = outputs;
+
+    genann *ann = genann_init_layers(hidden_layers + 2, width);
+    free(width);
+    if (!ann) return 0;
 
     int i;
     for (i = 0; i < ann->total_weights; ++i) {
-        fscanf(in, " %le", ann->weight + i);
+        fscanf(in, " %" GENANN_SCN, ann->weight + i);
     }
 
     return ann;
@@ -136,209 +404,626 @@ genann *genann_read(FILE *in) {
 
 
 genann *genann_copy(genann const *ann) {
-    const int size = sizeof(genann) + sizeof(double) * (ann->total_weights + ann->total_neurons + (ann->total_neurons - ann->inputs));
-    genann *ret = malloc(size);
+    /* Frozen anns have no output or delta buffers to copy. Mapped anns are
+     * copied into an ordinary allocation. */
+    const int moments = ann->moment ? genann_moments(ann->optimizer) : 0;
+    genann *ret = genann_alloc(ann->hidden_layers + 2, ann->width, 1, ann->output != 0, moments);
     if (!ret) return 0;
 
-    memcpy(ret, ann, size);
+    ret->activation_hidden = ann->activation_hidden;
+    ret->activation_output = ann->activation_output;
 
-    /* Set pointers. */
-    ret->weight = (double*)((char*)ret + sizeof(genann));
-    ret->output = ret->weight + ret->total_weights;
-    ret->delta = ret->output + ret->total_neurons;
+    /* The copy carries on training where ann left off. */
+    ret->optimizer = ann->optimizer;
+    ret->beta1 = ann->beta1;
+    ret->beta2 = ann->beta2;
+    ret->epsilon = ann->epsilon;
+    *ret->step = *ann->step;
+    if (moments) memcpy(ret->moment, ann->moment, sizeof(genann_real) * moments * ann->total_weights);
+
+    memcpy(ret->weight, ann->weight, sizeof(genann_real) * ann->total_weights);
+    if (ann->output) {
+        memcpy(ret->output, ann->output, sizeof(genann_real) * (ann->total_neurons + (ann->total_neurons - ann->inputs)));
+    }
+
+    return ret;
+}
+
+
+genann *genann_set_optimizer(genann *ann, int optimizer, double beta1, double beta2) {
+    const int moments = genann_moments(optimizer);
+    if (optimizer != GENANN_OPT_SGD && !moments) return 0;
+    if (!ann->output) return 0;
+
+    genann *ret = ann;
+    if (moments != (ann->moment ? genann_moments(ann->optimizer) : 0)) {
+        /* The state size changes: move to a new block. Mapped weights stay mapped. */
+        ret = genann_alloc(ann->hidden_layers + 2, ann->width, !ann->mapping, 1, moments);
+        if (!ret) return 0;
+
+        ret->activation_hidden = ann->activation_hidden;
+        ret->activation_output = ann->activation_output;
+        ret->epsilon = ann->epsilon;
+
+        if (ann->mapping) {
+            ret->weight = ann->weight;
+            ret->mapping = ann->mapping;
+            ret->mapping_size = ann->mapping_size;
+            ann->mapping = 0;
+        } else {
+            memcpy(ret->weight, ann->weight, sizeof(genann_real) * ann->total_weights);
+        }
+        genann_free(ann);
+    } else if (moments) {
+        memset(ret->moment, 0, sizeof(genann_real) * moments * ret->total_weights);
+    }
+
+    ret->optimizer = optimizer;
+    ret->beta1 = beta1;
+    ret->beta2 = beta2;
+    *ret->step = 0;
 
     return ret;
 }
 
 
+genann *genann_freeze(genann const *ann) {
+    genann *ret = genann_alloc(ann->hidden_layers + 2, ann->width, 1, 0, 0);
+    if (!ret) return 0;
+
+    ret->activation_hidden = ann->activation_hidden;
+    ret->activation_output = ann->activation_output;
+    memcpy(ret->weight, ann->weight, sizeof(genann_real) * ann->total_weights);
+
+    return ret;
+}
+
+
+int genann_copy_into(genann *dst, genann const *src) {
+    if (dst->hidden_layers != src->hidden_layers) return -1;
+
+    int l;
+    for (l = 0; l < src->hidden_layers + 2; ++l) {
+        if (dst->width[l] != src->width[l]) return -1;
+    }
+
+    dst->activation_hidden = src->activation_hidden;
+    dst->activation_output = src->activation_output;
+    if (dst->weight != src->weight) {
+        memcpy(dst->weight, src->weight, sizeof(genann_real) * src->total_weights);
+    }
+
+    return 0;
+}
+
+
 void genann_randomize(genann *ann) {
     int i;
     for (i = 0; i < ann->total_weights; ++i) {
-        double r = GENANN_RANDOM();
+        genann_real r = GENANN_RANDOM();
         /* Sets weights from -0.5 to 0.5. */
         ann->weight[i] = r - 0.5;
     }
 }
 
 
+/* A block of pool slots. The header takes the first cache line. */
+typedef struct pool_arena {
+    struct pool_arena *next;
+    void *raw;
+} pool_arena;
+
+
+struct genann_pool {
+    int layers;
+    int *width;
+
+    /* Bytes per ann, a multiple of 64. */
+    size_t slot;
+
+    /* Slots not in use, linked through their first bytes. */
+    void *free_slots;
+
+    pool_arena *arenas;
+
+    /* Slots in the next arena; doubles every time the pool grows. */
+    int grow;
+
+    int activation_hidden, activation_output;
+};
+
+
+genann_pool *genann_pool_create(genann const *shape, int capacity) {
+    const int layers = shape->hidden_layers + 2;
+
+    genann_pool *pool = malloc(sizeof(genann_pool) + sizeof(int) * layers);
+    if (!pool) return 0;
+
+    pool->layers = layers;
+    pool->width = (int*)(pool + 1);
+    memcpy(pool->width, shape->width, sizeof(int) * layers);
+    pool->slot = (genann_block_size(layers, shape->width, 1, 1, 0) + 63) / 64 * 64;
+    pool->free_slots = 0;
+    pool->arenas = 0;
+    pool->grow = capacity > 0 ? capacity : 1;
+    pool->activation_hidden = shape->activation_hidden;
+    pool->activation_output = shape->activation_output;
+
+    return pool;
+}
+
+
+/* Adds an arena of pool->grow slots, aligned to 64 bytes, to the free list. */
+static int pool_grow(genann_pool *pool) {
+    const size_t count = pool->grow;
+    void *raw = malloc(64 + count * pool->slot + 63);
+    if (!raw) return -1;
+
+    char *base = (char*)(((uintptr_t)raw + 63) & ~(uintptr_t)63);
+    pool_arena *arena = (pool_arena*)base;
+    arena->raw = raw;
+    arena->next = pool->arenas;
+    pool->arenas = arena;
+
+    size_t i;
+    for (i = count; i-- > 0;) {
+        void **slot = (void**)(base + 64 + i * pool->slot);
+        *slot = pool->free_slots;
+        pool->free_slots = slot;
+    }
+
+    if (pool->grow <= INT32_MAX / 2) pool->grow *= 2;
+    return 0;
+}
+
+
+genann *genann_pool_take(genann_pool *pool) {
+    if (!pool->free_slots && pool_grow(pool) != 0) return 0;
+
+    void **slot = pool->free_slots;
+    pool->free_slots = *slot;
+
+    genann *ret = genann_place(slot, pool->layers, pool->width, 1, 1, 0);
+    ret->pool = pool;
+    ret->activation_hidden = pool->activation_hidden;
+    ret->activation_output = pool->activation_output;
+
+    return ret;
+}
+
+
+genann *genann_pool_init(genann_pool *pool) {
+    genann *ret = genann_pool_take(pool);
+    if (ret) genann_randomize(ret);
+    return ret;
+}
+
+
+genann *genann_pool_copy(genann_pool *pool, genann const *ann) {
+    genann *ret = genann_pool_take(pool);
+    if (ret && genann_copy_into(ret, ann) != 0) {
+        genann_free(ret);
+        ret = 0;
+    }
+    return ret;
+}
+
+
+void genann_pool_free(genann_pool *pool) {
+    if (!pool) return;
+
+    while (pool->arenas) {
+        pool_arena *arena = pool->arenas;
+        pool->arenas = arena->next;
+        free(arena->raw);
+    }
+    free(pool);
+}
+
+
 void genann_free(genann *ann) {
-    /* The weight, output, and delta pointers go to the same buffer. */
+    if (!ann) return;
+
+    /* Pooled anns go back on their pool's free list. */
+    if (ann->pool) {
+        void **slot = (void**)ann;
+        *slot = ann->pool->free_slots;
+        ann->pool->free_slots = slot;
+        return;
+    }
+
+#ifdef GENANN_HAVE_MMAP
+    if (ann->mapping) munmap(ann->mapping, ann->mapping_size);
+#endif
+
+    /* The weight, output, and delta pointers go to the same buffer,
+     * unless the weights are mapped from a file. */
     free(ann);
 }
 
 
-double const *genann_run(genann const *ann, double const *inputs) {
-    double const *w = ann->weight;
-    double *o = ann->output + ann->inputs;
-    double const *i = ann->output;
+genann_real const *genann_run(genann const *ann, genann_real const *inputs) {
+    return genann_run_r(ann, inputs, ann->output);
+}
 
+
+genann_real const *genann_run_r(genann const *ann, genann_real const *inputs, genann_real *scratch) {
     /* Copy the inputs to the scratch area, where we also store each neuron's
      * output, for consistency. This way the first layer isn't a special case. */
-    memcpy(ann->output, inputs, sizeof(double) * ann->inputs);
+    memcpy(scratch, inputs, sizeof(genann_real) * ann->inputs);
+
+    int l, j;
+
+    /* Each layer's pre-activations are written first, then the activation
+     * function runs over the whole layer at once. */
+    for (l = 1; l <= ann->hidden_layers + 1; ++l) {
+        const int ins = ann->width[l-1];
+        const int outs = ann->width[l];
+        genann_real const *w = ann->weight + ann->weight_offset[l];
+        genann_real const *i = scratch + ann->neuron_offset[l-1];
+        genann_real *o = scratch + ann->neuron_offset[l];
+
+        for (j = 0; j < outs; ++j) {
+            o[j] = *w * -1.0 + genann_kern.dot(w + 1, i, ins);
+            w += ins + 1;
+        }
+        genann_act_layer(l <= ann->hidden_layers ? ann->activation_hidden : ann->activation_output, o, outs);
 
-    int h, j, k;
+        /* Sanity check that each layer used exactly its own weights. */
+        assert(w - ann->weight == ann->weight_offset[l+1]);
+    }
 
-    const genann_actfun act = ann->activation_hidden;
-    const genann_actfun acto = ann->activation_output;
+    return scratch + ann->neuron_offset[ann->hidden_layers + 1];
+}
 
-    /* Figure hidden layers, if any. */
-    for (h = 0; h < ann->hidden_layers; ++h) {
-        for (j = 0; j < ann->hidden; ++j) {
-            double sum = *w++ * -1.0;
-            for (k = 0; k < (h == 0 ? ann->inputs : ann->hidden); ++k) {
-                sum += *w++ * i[k];
-            }
-            *o++ = act(sum);
+
+/* Computes one layer for a block of n observations stored row-major.
+ * Four neurons are handled per pass over the block, so each input row is read
+ * once per four weight rows and the weight rows stay in cache for the whole block. */
+static void genann_layer_block(genann_real const *w, int ins, int outs, int activation,
+        genann_real const *in, int n, genann_real *out) {
+    const int stride = ins + 1;
+    int j, s;
+    genann_real sum[4];
+
+    for (j = 0; j + 4 <= outs; j += 4, w += 4 * stride) {
+        genann_real const *w0 = w, *w1 = w + stride, *w2 = w + 2 * stride, *w3 = w + 3 * stride;
+        for (s = 0; s < n; ++s) {
+            genann_kern.dot4(w0 + 1, w1 + 1, w2 + 1, w3 + 1, in + s * ins, ins, sum);
+            genann_real *o = out + s * outs + j;
+            o[0] = *w0 * -1.0 + sum[0];
+            o[1] = *w1 * -1.0 + sum[1];
+            o[2] = *w2 * -1.0 + sum[2];
+            o[3] = *w3 * -1.0 + sum[3];
+        }
+    }
+
+    /* Remaining neurons one at a time. */
+    for (; j < outs; ++j, w += stride) {
+        for (s = 0; s < n; ++s) {
+            out[s * outs + j] = *w * -1.0 + genann_kern.dot(w + 1, in + s * ins, ins);
         }
+    }
+
+    /* The block is dense, so one call activates every neuron of every observation. */
+    genann_act_layer(activation, out, n * outs);
+}
 
 
-        i += (h == 0 ? ann->inputs : ann->hidden);
+int genann_run_batch(genann const *ann, genann_real const *inputs, int n, genann_real *outputs) {
+    int widest = 0, l;
+    for (l = 1; l <= ann->hidden_layers; ++l) {
+        if (ann->width[l] > widest) widest = ann->width[l];
     }
 
-    double const *ret = o;
+    /* Two blocks of hidden activations, used alternately as layer input and output. */
+    genann_real *scratch = malloc(sizeof(genann_real) * 2 * BATCH_BLOCK * (widest ? widest : 1));
+    if (!scratch) return -1;
 
-    /* Figure output layer. */
-    for (j = 0; j < ann->outputs; ++j) {
-        double sum = *w++ * -1.0;
-        for (k = 0; k < (ann->hidden_layers ? ann->hidden : ann->inputs); ++k) {
-            sum += *w++ * i[k];
+    int b;
+    for (b = 0; b < n; b += BATCH_BLOCK) {
+        const int m = (n - b < BATCH_BLOCK) ? n - b : BATCH_BLOCK;
+
+        genann_real const *in = inputs + (size_t)b * ann->inputs;
+        genann_real *cur = scratch;
+
+        for (l = 1; l <= ann->hidden_layers; ++l) {
+            genann_layer_block(ann->weight + ann->weight_offset[l], ann->width[l-1], ann->width[l],
+                    ann->activation_hidden, in, m, cur);
+            in = cur;
+            cur = (cur == scratch) ? scratch + BATCH_BLOCK * widest : scratch;
         }
-        *o++ = acto(sum);
+
+        genann_layer_block(ann->weight + ann->weight_offset[l], ann->width[l-1], ann->outputs,
+                ann->activation_output, in, m, outputs + (size_t)b * ann->outputs);
     }
 
-    /* Sanity check that we used all weights and wrote all outputs. */
-    assert(w - ann->weight == ann->total_weights);
-    assert(o - ann->output == ann->total_neurons);
+    free(scratch);
+    return 0;
+}
 
-    return ret;
+
+double genann_loss(genann const *ann, genann_real const *inputs, genann_real const *desired_outputs, int n) {
+    if (n < 1) return 0;
+
+    /* Outputs are computed a chunk at a time so the buffer stays small. */
+    const int chunk = n < 1024 ? n : 1024;
+    genann_real *outputs = malloc(sizeof(genann_real) * chunk * ann->outputs);
+    if (!outputs) return -1;
+
+    double sum = 0;
+    int b, k;
+    for (b = 0; b < n; b += chunk) {
+        const int m = (n - b < chunk) ? n - b : chunk;
+        if (genann_run_batch(ann, inputs + (size_t)b * ann->inputs, m, outputs) != 0) {
+            free(outputs);
+            return -1;
+        }
+
+        genann_real const *t = desired_outputs + (size_t)b * ann->outputs;
+        for (k = 0; k < m * ann->outputs; ++k) {
+            const double e = t[k] - outputs[k];
+            sum += e * e;
+        }
+    }
+
+    free(outputs);
+    return sum / ((double)n * ann->outputs);
 }
 
 
-void genann_train(genann const *ann, double const *inputs, double const *desired_outputs, double learning_rate) {
-    /* To begin with, we must run the network forward. */
-    genann_run(ann, inputs);
+size_t genann_gradient_work(genann const *ann, int n) {
+    return (size_t)2 * n * (ann->total_neurons - ann->inputs);
+}
 
-    int h, j, k;
 
-    /* First set the output layer deltas. */
+void genann_gradient(genann const *ann, genann_real const *inputs, genann_real const *desired_outputs, int n,
+        genann_real *grad, genann_real *work) {
+    const int neurons = ann->total_neurons - ann->inputs;
+    const int last = ann->hidden_layers + 1;
+
+    /* Activations and deltas of every neuron for every observation, stored
+     * layer by layer with one row per observation. Layer l starts n times
+     * its neuron offset (less the inputs) into each. */
+    genann_real *act = work;
+    genann_real *delta = act + (size_t)n * neurons;
+#define LAYER(buf, l) ((buf) + (size_t)n * (ann->neuron_offset[l] - ann->inputs))
+
+    int l, j, k, s;
+
+    /* Forward pass over the whole batch. */
+    for (l = 1; l <= last; ++l) {
+        genann_layer_block(ann->weight + ann->weight_offset[l], ann->width[l-1], ann->width[l],
+                l < last ? ann->activation_hidden : ann->activation_output,
+                l > 1 ? LAYER(act, l-1) : inputs, n, LAYER(act, l));
+    }
+
+    /* Output layer deltas. */
     {
-        double const *o = ann->output + ann->inputs + ann->hidden * ann->hidden_layers; /* First output. */
-        double *d = ann->delta + ann->hidden * ann->hidden_layers; /* First delta. */
-        double const *t = desired_outputs; /* First desired output. */
+        genann_real const *o = LAYER(act, last);
+        genann_real *d = LAYER(delta, last);
+        genann_real const *t = desired_outputs;
+        const int count = n * ann->outputs;
 
+        for (j = 0; j < count; ++j) {
+            d[j] = t[j] - o[j];
+        }
+        genann_act_layer_derivative(ann->activation_output, o, d, count);
+    }
 
-        /* Set output layer deltas. */
-        if (ann->activation_output == genann_act_linear) {
-            for (j = 0; j < ann->outputs; ++j) {
-                *d++ = *t++ - *o++;
+    /* Hidden layer deltas, last layer first: D = (D_next * W_next) .* f'(O). */
+    for (l = last - 1; l >= 1; --l) {
+        const int outs = ann->width[l];
+        const int next = ann->width[l+1];
+        const int stride = outs + 1;
+        genann_real const *o = LAYER(act, l);
+        genann_real *d = LAYER(delta, l);
+        genann_real const *dd = LAYER(delta, l+1);
+        genann_real const *ww = ann->weight + ann->weight_offset[l+1];
+
+        for (s = 0; s < n; ++s) {
+            genann_real *drow = d + (size_t)s * outs;
+            genann_real const *ddrow = dd + (size_t)s * next;
+
+            for (j = 0; j < outs; ++j) drow[j] = 0;
+
+            for (k = 0; k < next; ++k) {
+                genann_kern.axpy(ddrow[k], ww + k * stride + 1, drow, outs);
             }
-        } else {
-            for (j = 0; j < ann->outputs; ++j) {
-                *d++ = (*t - *o) * *o * (1.0 - *o);
-                ++o; ++t;
+        }
+
+        genann_act_layer_derivative(ann->activation_hidden, o, d, n * outs);
+    }
+
+    /* Accumulate gradients, G = D^T * [-1 X], one weight row at a time so
+     * the row stays in cache while the batch streams past. */
+    for (l = 1; l <= last; ++l) {
+        const int ins = ann->width[l-1];
+        const int outs = ann->width[l];
+        genann_real const *x = l > 1 ? LAYER(act, l-1) : inputs;
+        genann_real const *d = LAYER(delta, l);
+        genann_real *g = grad + ann->weight_offset[l];
+
+        for (j = 0; j < outs; ++j, g += ins + 1) {
+            for (k = 0; k <= ins; ++k) g[k] = 0;
+
+            for (s = 0; s < n; ++s) {
+                const genann_real ds = d[(size_t)s * outs + j];
+                g[0] -= ds;
+                genann_kern.axpy(ds, x + (size_t)s * ins, g + 1, ins);
             }
         }
+
+        assert(g - grad == ann->weight_offset[l+1]);
     }
+#undef LAYER
+}
 
 
-    /* Set hidden layer deltas, start on last layer and work backwards. */
-    /* Note that loop is skipped in the case of hidden_layers == 0. */
-    for (h = ann->hidden_layers - 1; h >= 0; --h) {
+void genann_update(genann const *ann, genann_real const *grad, double learning_rate, int first, int n) {
+    genann_real *w = ann->weight + first;
+    genann_real const *g = grad + first;
+
+    /* One fused pass per weight range: the state and the weight are read and
+     * written once each. */
+    switch (ann->moment ? ann->optimizer : GENANN_OPT_SGD) {
+        case GENANN_OPT_MOMENTUM:
+        case GENANN_OPT_NESTEROV:
+            genann_kern.momentum(w, ann->moment + first, g, ann->beta1, learning_rate,
+                    ann->optimizer == GENANN_OPT_NESTEROV, n);
+            break;
+
+        case GENANN_OPT_ADAM: {
+            /* Bias correction is folded into the step size and epsilon. */
+            const double t = *ann->step > 0 ? (double)*ann->step : 1;
+            const double c1 = 1 - pow(ann->beta1, t);
+            const double c2 = sqrt(1 - pow(ann->beta2, t));
+            genann_kern.adam(w, ann->moment + first, ann->moment + ann->total_weights + first, g,
+                    ann->beta1, ann->beta2, learning_rate * c2 / c1, ann->epsilon * c2, n);
+            break;
+        }
 
-        /* Find first output and delta in this layer. */
-        double const *o = ann->output + ann->inputs + (h * ann->hidden);
-        double *d = ann->delta + (h * ann->hidden);
+        default:
+            genann_kern.axpy(learning_rate, g, w, n);
+            break;
+    }
+}
 
-        /* Find first delta in following layer (which may be hidden or output). */
-        double const * const dd = ann->delta + ((h+1) * ann->hidden);
 
-        /* Find first weight in following layer (which may be hidden or output). */
-        double const * const ww = ann->weight + ((ann->inputs+1) * ann->hidden) + ((ann->hidden+1) * ann->hidden * (h));
+size_t genann_train_batch_work(genann const *ann, int n) {
+    return ann->total_weights + genann_gradient_work(ann, n);
+}
 
-        for (j = 0; j < ann->hidden; ++j) {
 
-            double delta = 0;
+void genann_train_batch_r(genann const *ann, genann_real const *inputs, genann_real const *desired_outputs, int n,
+        double learning_rate, genann_real *work) {
+    if (n < 1) return;
 
-            for (k = 0; k < (h == ann->hidden_layers-1 ? ann->outputs : ann->hidden); ++k) {
-                const double forward_delta = dd[k];
-                const int windex = k * (ann->hidden + 1) + (j + 1);
-                const double forward_weight = ww[windex];
-                delta += forward_delta * forward_weight;
-            }
+    /* The gradient first, then the forward and backward pass's work space. */
+    genann_gradient(ann, inputs, desired_outputs, n, work, work + ann->total_weights);
+
+    /* One update for the whole batch. */
+    ++*ann->step;
+    genann_update(ann, work, learning_rate, 0, ann->total_weights);
+}
+
+
+int genann_train_batch(genann const *ann, genann_real const *inputs, genann_real const *desired_outputs, int n, double learning_rate) {
+    if (n < 1) return 0;
+
+    genann_real *work = malloc(sizeof(genann_real) * genann_train_batch_work(ann, n));
+    if (!work) return -1;
+
+    genann_train_batch_r(ann, inputs, desired_outputs, n, learning_rate, work);
 
-            *d = *o * (1.0-*o) * delta;
-            ++d; ++o;
+    free(work);
+    return 0;
+}
+
+
+void genann_train(genann const *ann, genann_real const *inputs, genann_real const *desired_outputs, double learning_rate) {
+    /* The delta buffer directly follows the output buffer in the allocation. */
+    genann_train_r(ann, inputs, desired_outputs, learning_rate, ann->output);
+}
+
+
+void genann_train_r(genann const *ann, genann_real const *inputs, genann_real const *desired_outputs, double learning_rate,
+        genann_real *scratch) {
+    genann_real *const output = scratch;
+
+    /* Deltas are indexed like outputs, less the inputs, which have none. */
+    genann_real *const delta = scratch + ann->total_neurons - ann->inputs;
+
+    const int last = ann->hidden_layers + 1;
+
+    /* To begin with, we must run the network forward. */
+    genann_run_r(ann, inputs, output);
+
+    int l, j, k;
+
+    /* First set the output layer deltas. */
+    {
+        genann_real const *o = output + ann->neuron_offset[last]; /* First output. */
+        genann_real *d = delta + ann->neuron_offset[last]; /* First delta. */
+        genann_real const *t = desired_outputs; /* First desired output. */
+
+
+        /* Set output layer deltas. */
+        for (j = 0; j < ann->outputs; ++j) {
+            d[j] = t[j] - o[j];
         }
+        genann_act_layer_derivative(ann->activation_output, o, d, ann->outputs);
     }
 
 
-    /* Train the outputs. */
-    {
-        /* Find first output delta. */
-        double const *d = ann->delta + ann->hidden * ann->hidden_layers; /* First output delta. */
+    /* Set hidden layer deltas, start on last layer and work backwards. */
+    /* Note that loop is skipped in the case of hidden_layers == 0. */
+    for (l = last - 1; l >= 1; --l) {
+        const int outs = ann->width[l];
+        const int next = ann->width[l+1];
 
-        /* Find first weight to first output delta. */
-        double *w = ann->weight + (ann->hidden_layers
-                ? ((ann->inputs+1) * ann->hidden + (ann->hidden+1) * ann->hidden * (ann->hidden_layers-1))
-                : (0));
+        /* Find first output and delta in this layer. */
+        genann_real const *o = output + ann->neuron_offset[l];
+        genann_real *d = delta + ann->neuron_offset[l];
 
-        /* Find first output in previous layer. */
-        double const * const i = ann->output + (ann->hidden_layers
-                ? (ann->inputs + (ann->hidden) * (ann->hidden_layers-1))
-                : 0);
+        /* Find first delta in following layer (which may be hidden or output). */
+        genann_real const * const dd = delta + ann->neuron_offset[l+1];
 
-        /* Set output layer weights. */
-        for (j = 0; j < ann->outputs; ++j) {
-            for (k = 0; k < (ann->hidden_layers ? ann->hidden : ann->inputs) + 1; ++k) {
-                if (k == 0) {
-                    *w++ += *d * learning_rate * -1.0;
-                } else {
-                    *w++ += *d * learning_rate * i[k-1];
-                }
-            }
+        /* Find first weight in following layer (which may be hidden or output). */
+        genann_real const * const ww = ann->weight + ann->weight_offset[l+1];
 
-            ++d;
+        /* Sum the forward deltas through each following neuron's weight row,
+         * skipping its bias weight, then scale by the activation derivative. */
+        for (j = 0; j < outs; ++j) d[j] = 0;
+
+        for (k = 0; k < next; ++k) {
+            genann_kern.axpy(dd[k], ww + k * (outs + 1) + 1, d, outs);
         }
 
-        assert(w - ann->weight == ann->total_weights);
+        genann_act_layer_derivative(ann->activation_hidden, o, d, outs);
     }
 
 
-    /* Train the hidden layers. */
-    for (h = ann->hidden_layers - 1; h >= 0; --h) {
+    /* Train the weights into each layer, output layer first. */
+    for (l = last; l >= 1; --l) {
+        const int ins = ann->width[l-1];
+        const int outs = ann->width[l];
 
         /* Find first delta in this layer. */
-        double const *d = ann->delta + (h * ann->hidden);
+        genann_real const *d = delta + ann->neuron_offset[l];
 
         /* Find first input to this layer. */
-        double const *i = ann->output + (h
-                ? (ann->inputs + ann->hidden * (h-1))
-                : 0);
+        genann_real const *i = output + ann->neuron_offset[l-1];
 
         /* Find first weight to this layer. */
-        double *w = ann->weight + (h
-                ? ((ann->inputs+1) * ann->hidden + (ann->hidden+1) * (ann->hidden) * (h-1))
-                : 0);
-
-
-        for (j = 0; j < ann->hidden; ++j) {
-            for (k = 0; k < (h == 0 ? ann->inputs : ann->hidden) + 1; ++k) {
-                if (k == 0) {
-                    *w++ += *d * learning_rate * -1.0;
-                } else {
-                    *w++ += *d * learning_rate * i[k-1];
-                }
-            }
+        genann_real *w = ann->weight + ann->weight_offset[l];
+
+        for (j = 0; j < outs; ++j) {
+            const genann_real step = *d * learning_rate;
+            *w += step * -1.0;
+            genann_kern.axpy(step, i, w + 1, ins);
+            w += ins + 1;
             ++d;
         }
 
+        assert(w - ann->weight == ann->weight_offset[l+1]);
     }
 
 }
 
 
 void genann_write(genann const *ann, FILE *out) {
-    fprintf(out, "%d %d %d %d", ann->inputs, ann->hidden_layers, ann->hidden, ann->outputs);
+    /* Uniform anns keep the original header. Otherwise the hidden width is
+     * written as -1 and followed by the width of each hidden layer. */
+    if (genann_uniform(ann)) {
+        fprintf(out, "%d %d %d %d", ann->inputs, ann->hidden_layers, ann->hidden, ann->outputs);
+    } else {
+        fprintf(out, "%d %d %d %d", ann->inputs, ann->hidden_layers, -1, ann->outputs);
+        int l;
+        for (l = 1; l <= ann->hidden_layers; ++l) {
+            fprintf(out, " %d", ann->width[l]);
+        }
+    }
 
     int i;
     for (i = 0; i < ann->total_weights; ++i) {
@@ -347,3 +1032,213 @@ void genann_write(genann const *ann, FILE *out) {
 }
 
 
+
+
+/* Binary format, all fields in the writer's byte order:
+ *
+ *   binary_header
+ *   uint32_t width[layers]       inputs, each hidden layer, outputs
+ *   zero padding                 up to payload_offset, a multiple of 64
+ *   genann_real weight[total_weights]
+ *
+ * The checksum is FNV-1a over the weight payload. */
+
+#define BINARY_MAGIC "GENANNB"
+#define BINARY_VERSION 1
+#define BINARY_BYTE_ORDER 0x01020304u
+#define BINARY_ALIGN 64
+
+typedef struct binary_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t scalar_size;
+    uint32_t layers;
+    uint32_t activation_hidden;
+    uint32_t activation_output;
+    uint64_t total_weights;
+    uint64_t payload_offset;
+    uint64_t checksum;
+} binary_header;
+
+
+static uint64_t genann_checksum(void const *data, size_t size) {
+    unsigned char const *p = data;
+    uint64_t h = 14695981039346656037ull;
+    size_t i;
+    for (i = 0; i < size; ++i) {
+        h = (h ^ p[i]) * 1099511628211ull;
+    }
+    return h;
+}
+
+
+static size_t binary_payload_offset(int layers) {
+    const size_t end = sizeof(binary_header) + sizeof(uint32_t) * layers;
+    return (end + BINARY_ALIGN - 1) / BINARY_ALIGN * BINARY_ALIGN;
+}
+
+
+int genann_write_binary(genann const *ann, FILE *out) {
+    const int layers = ann->hidden_layers + 2;
+    const size_t payload = sizeof(genann_real) * ann->total_weights;
+
+    binary_header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    h.version = BINARY_VERSION;
+    h.byte_order = BINARY_BYTE_ORDER;
+    h.scalar_size = sizeof(genann_real);
+    h.layers = layers;
+    h.activation_hidden = ann->activation_hidden;
+    h.activation_output = ann->activation_output;
+    h.total_weights = ann->total_weights;
+    h.payload_offset = binary_payload_offset(layers);
+    h.checksum = genann_checksum(ann->weight, payload);
+
+    if (fwrite(&h, sizeof(h), 1, out) != 1) return -1;
+
+    int l;
+    for (l = 0; l < layers; ++l) {
+        const uint32_t width = ann->width[l];
+        if (fwrite(&width, sizeof(width), 1, out) != 1) return -1;
+    }
+
+    static const char zero[BINARY_ALIGN];
+    const size_t pad = h.payload_offset - sizeof(h) - sizeof(uint32_t) * layers;
+    if (pad && fwrite(zero, 1, pad, out) != pad) return -1;
+
+    if (fwrite(ann->weight, 1, payload, out) != payload) return -1;
+
+    return 0;
+}
+
+
+/* Checks a header and its width table, and allocates a matching ann with
+ * weights only if with_weights is set, left uninitialized for the caller to
+ * fill. size is the size of the whole file, header included, which must hold
+ * payload_offset plus the payload; 0 if unknown. */
+static genann *binary_check(binary_header const *h, uint32_t const *width, size_t size, int with_weights) {
+    if (memcmp(h->magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0) return 0;
+    if (h->version != BINARY_VERSION) return 0;
+    if (h->byte_order != BINARY_BYTE_ORDER) return 0;
+    if (h->scalar_size != sizeof(genann_real)) return 0;
+    if (h->layers < 2 || h->layers > 65536 || h->payload_offset != binary_payload_offset(h->layers)) return 0;
+
+    /* A corrupt or newer file must not run with some other activation. */
+    if (!genann_activation_valid(h->activation_hidden) || !genann_activation_valid(h->activation_output)) return 0;
+
+#ifndef __GNUC__
+    genann_init_sigmoid_lookup();
+#endif
+
+    int *w = malloc(sizeof(int) * h->layers);
+    if (!w) return 0;
+
+    uint32_t l;
+    uint64_t total_weights = 0;
+    for (l = 0; l < h->layers; ++l) {
+        if (width[l] < 1 || width[l] > 1u << 24) {
+            free(w);
+            return 0;
+        }
+        w[l] = width[l];
+        if (l) total_weights += (uint64_t)(width[l-1] + 1) * width[l];
+    }
+
+    genann *ann = 0;
+    if (total_weights == h->total_weights && total_weights < 1u << 31 &&
+            (!size || h->payload_offset + sizeof(genann_real) * h->total_weights <= size)) {
+        ann = genann_alloc(h->layers, w, with_weights, 1, 0);
+    }
+    free(w);
+    if (!ann) return 0;
+
+    ann->activation_hidden = h->activation_hidden;
+    ann->activation_output = h->activation_output;
+
+    return ann;
+}
+
+
+genann *genann_read_binary(FILE *in) {
+    binary_header h;
+    if (fread(&h, sizeof(h), 1, in) != 1) return 0;
+    if (h.layers < 2 || h.layers > 65536) return 0;
+
+    uint32_t *width = malloc(sizeof(uint32_t) * h.layers);
+    if (!width) return 0;
+    if (fread(width, sizeof(uint32_t), h.layers, in) != h.layers) {
+        free(width);
+        return 0;
+    }
+
+    /* The file overwrites every weight, so none are randomized: loading a
+     * model leaves the caller's rand() stream alone. */
+    genann *ann = binary_check(&h, width, 0, 1);
+    free(width);
+    if (!ann) return 0;
+
+    /* Skip the padding, then read the payload in one go. */
+    const long pad = (long)(h.payload_offset - sizeof(h) - sizeof(uint32_t) * h.layers);
+    const size_t payload = sizeof(genann_real) * ann->total_weights;
+    if (fseek(in, pad, SEEK_CUR) != 0 ||
+            fread(ann->weight, 1, payload, in) != payload ||
+            genann_checksum(ann->weight, payload) != h.checksum) {
+        genann_free(ann);
+        return 0;
+    }
+
+    return ann;
+}
+
+
+genann *genann_map(char const *path, int flags) {
+#ifdef GENANN_HAVE_MMAP
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(binary_header)) {
+        close(fd);
+        return 0;
+    }
+
+    /* Private and writable: pages are shared with the page cache and other
+     * processes until someone trains the ann, which copies just those pages. */
+    const size_t size = st.st_size;
+    void *map = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return 0;
+
+    binary_header const *h = map;
+    genann *ann = 0;
+    if (sizeof(binary_header) + sizeof(uint32_t) * (size_t)h->layers <= size) {
+        ann = binary_check(h, (uint32_t const *)(h + 1), size, 0);
+    }
+
+    if (ann) {
+        ann->weight = (genann_real*)((char*)map + h->payload_offset);
+        ann->mapping = map;
+        ann->mapping_size = size;
+
+        if ((flags & GENANN_MAP_VERIFY) &&
+                genann_checksum(ann->weight, sizeof(genann_real) * ann->total_weights) != h->checksum) {
+            genann_free(ann);
+            ann = 0;
+        }
+    } else {
+        munmap(map, size);
+    }
+
+    return ann;
+#else
+    /* No mmap here; fall back to reading a private copy, which is always verified. */
+    (void)flags;
+    FILE *in = fopen(path, "rb");
+    if (!in) return 0;
+    genann *ann = genann_read_binary(in);
+    fclose(in);
+    return ann;
+#endif
+}
@@ -28,6 +28,7 @@
 #define __GENANN_H__
 
 #include <stdio.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -39,19 +40,71 @@ extern "C" {
 #define GENANN_RANDOM() (((double)rand())/RAND_MAX)
 #endif
 
+#ifdef GENANN_FLOAT
+/* Single precision build: halves memory traffic and doubles SIMD width. */
+typedef float genann_real;
+#define GENANN_SCN "f"
+#else
+typedef double genann_real;
+#define GENANN_SCN "lf"
+#endif
+
+/* Use as "%" GENANN_SCN to scanf a genann_real. */
+
+
+/* Activation functions. Each is applied to a whole layer at a time and has a
+ * matching derivative used by training. */
+#define GENANN_ACT_SIGMOID 0
+#define GENANN_ACT_SIGMOID_CACHED 1
+#define GENANN_ACT_THRESHOLD 2
+#define GENANN_ACT_LINEAR 3
+#define GENANN_ACT_TANH 4
+#define GENANN_ACT_RELU 5
+
 
-typedef double (*genann_actfun)(double a);
+/* Update rules for batch training; see genann_set_optimizer. */
+#define GENANN_OPT_SGD 0
+#define GENANN_OPT_MOMENTUM 1
+#define GENANN_OPT_NESTEROV 2
+#define GENANN_OPT_ADAM 3
+
+
+typedef struct genann_pool genann_pool;
 
 
 typedef struct genann {
-    /* How many inputs, outputs, and hidden neurons. */
+    /* How many inputs, outputs, and hidden neurons. hidden is the width of the
+     * widest hidden layer; see width for each layer. */
     int inputs, hidden_layers, hidden, outputs;
 
-    /* Which activation function to use for hidden neurons. Default: gennann_act_sigmoid_cached*/
-    genann_actfun activation_hidden;
+    /* Layers are numbered from 0 (inputs) to hidden_layers + 1 (outputs).
+     * These tables are hidden_layers + 3 long and computed once at init. */
+
+    /* Neurons in each layer; the last entry is 0. */
+    int *width;
+
+    /* Index in output of each layer's first neuron; the last entry is total_neurons.
+     * A layer's deltas start at the same index less inputs. */
+    int *neuron_offset;
+
+    /* Index in weight of the first weight into each layer; the last entry is total_weights. */
+    int *weight_offset;
 
-    /* Which activation function to use for output. Default: gennann_act_sigmoid_cached*/
-    genann_actfun activation_output;
+    /* Which activation function to use for hidden neurons; see genann_set_activation. Default: GENANN_ACT_SIGMOID_CACHED*/
+    int activation_hidden;
+
+    /* Which activation function to use for output. Default: GENANN_ACT_SIGMOID_CACHED*/
+    int activation_output;
+
+    /* Update rule for batch training. Default: GENANN_OPT_SGD */
+    int optimizer;
+
+    /* Momentum coefficient, or Adam's decay rates and epsilon (default 1e-8). */
+    double beta1, beta2, epsilon;
+
+    /* Batch updates made so far. Lives in the allocation, like the weights,
+     * so training through a const ann can count. */
+    long *step;
 
     /* Total number of weights, and size of weights buffer. */
     int total_weights;
@@ -60,13 +113,25 @@ typedef struct genann {
     int total_neurons;
 
     /* All weights (total_weights long). */
-    double *weight;
+    genann_real *weight;
+
+    /* Optimizer state, right after the weights in the same allocation: the
+     * velocity for momentum and Nesterov, or Adam's first then second moment
+     * (total_weights long each). Null for GENANN_OPT_SGD. */
+    genann_real *moment;
 
-    /* Stores input array and output of each neuron (total_neurons long). */
-    double *output;
+    /* Stores input array and output of each neuron (total_neurons long). Null if frozen. */
+    genann_real *output;
 
-    /* Stores delta of each hidden and output neuron (total_neurons - inputs long). */
-    double *delta;
+    /* Stores delta of each hidden and output neuron (total_neurons - inputs long). Null if frozen. */
+    genann_real *delta;
+
+    /* File mapping that holds the weights, if loaded by genann_map; otherwise null. */
+    void *mapping;
+    size_t mapping_size;
+
+    /* Pool the ann was taken from, if any; genann_free gives it back. */
+    genann_pool *pool;
 
 } genann;
 
@@ -75,32 +140,169 @@ typedef struct genann {
 /* Creates and returns a new ann. */
 genann *genann_init(int inputs, int hidden_layers, int hidden, int outputs);
 
+/* Creates an ann with any width per layer: width[0] inputs, then width[1]
+ * to width[layers-2] hidden neurons, then width[layers-1] outputs. layers
+ * counts the input and output layers, so it is at least 2. */
+genann *genann_init_layers(int layers, int const *width);
+
 /* Creates ANN from file saved with genann_write. */
 genann *genann_read(FILE *in);
 
 /* Sets weights randomly. Called by init. */
 void genann_randomize(genann *ann);
 
+/* Switches the update rule used by genann_train_batch and synchronous
+ * parallel training, and resets its state. beta1 is the momentum
+ * coefficient (e.g. 0.9) or Adam's first moment decay (0.9); beta2 is Adam's
+ * second moment decay (0.999) and is otherwise ignored. The state buffers
+ * are kept in ann's allocation, so ann may be moved: like realloc, returns
+ * the new ann and invalidates the old pointer, or returns 0 and leaves ann
+ * unchanged on failure or if ann is frozen. genann_train and Hogwild
+ * training always take plain SGD steps. */
+genann *genann_set_optimizer(genann *ann, int optimizer, double beta1, double beta2);
+
+/* Sets the activation functions (GENANN_ACT_*) of ann's hidden layers and
+ * output layer. Returns 0 on success, -1 leaving ann unchanged if either id
+ * is unknown. */
+int genann_set_activation(genann *ann, int hidden, int output);
+
+/* Returns 1 if activation is one of the GENANN_ACT_* ids, 0 if not. */
+int genann_activation_valid(int activation);
+
 /* Returns a new copy of ann. */
 genann *genann_copy(genann const *ann);
 
-/* Frees the memory used by an ann. */
+/* Returns a weights-only copy of ann for inference, with no output or delta
+ * buffers. Frozen anns can't be trained and must be run with genann_run_r. */
+genann *genann_freeze(genann const *ann);
+
+/* Copies src's weights and activation functions into dst, which must have
+ * the same layer widths, without allocating. Scratch buffers and optimizer
+ * state are left alone, so dst may be frozen. Returns 0 on success, -1 if
+ * the topologies differ. */
+int genann_copy_into(genann *dst, genann const *src);
+
+/* Frees the memory used by an ann, or returns it to its pool. */
 void genann_free(genann *ann);
 
+
+/* A pool of anns with one topology, carved out of large 64-byte aligned
+ * arenas so taking and freeing an ann never calls malloc once the pool is
+ * warm. Pooled anns start 64-byte aligned, as do their weights, and are
+ * trainable; free them with genann_free. A pool is not thread safe: take and
+ * free its anns from one thread at a time. */
+
+/* Creates a pool for anns shaped like shape, with room for capacity anns
+ * before it first grows. Returns 0 on failure. */
+genann_pool *genann_pool_create(genann const *shape, int capacity);
+
+/* Takes an ann from the pool with unset weights, and the pool's
+ * activation functions. Returns 0 if the pool could not grow. */
+genann *genann_pool_take(genann_pool *pool);
+
+/* Takes an ann from the pool and randomizes it, like genann_init. */
+genann *genann_pool_init(genann_pool *pool);
+
+/* Takes an ann from the pool and copies ann's weights into it. Returns 0 if
+ * the pool could not grow or ann has another topology. */
+genann *genann_pool_copy(genann_pool *pool, genann const *ann);
+
+/* Frees a pool and every ann in it, taken or not. */
+void genann_pool_free(genann_pool *pool);
+
 /* Runs the feedforward algorithm to calculate the ann's output. */
-double const *genann_run(genann const *ann, double const *inputs);
+genann_real const *genann_run(genann const *ann, genann_real const *inputs);
+
+/* Reentrant version of genann_run. Activations go to scratch, which must hold
+ * total_neurons values, and ann is only read. Threads can share one ann as
+ * long as each passes its own scratch. Returns a pointer to the outputs in scratch. */
+genann_real const *genann_run_r(genann const *ann, genann_real const *inputs, genann_real *scratch);
+
+/* Runs n observations (row-major, inputs values each) through the ann and
+ * writes n rows of outputs values to outputs. Does not touch ann->output.
+ * Returns 0 on success, -1 if scratch memory could not be allocated. */
+int genann_run_batch(genann const *ann, genann_real const *inputs, int n, genann_real *outputs);
+
+/* Returns the mean squared error of the ann over n observations (row-major),
+ * the loss genann_train minimizes, averaged over all outputs. Returns -1 if
+ * scratch memory could not be allocated. */
+double genann_loss(genann const *ann, genann_real const *inputs, genann_real const *desired_outputs, int n);
 
 /* Does a single backprop update. */
-void genann_train(genann const *ann, double const *inputs, double const *desired_outputs, double learning_rate);
+void genann_train(genann const *ann, genann_real const *inputs, genann_real const *desired_outputs, double learning_rate);
+
+/* Reentrant version of genann_train. Activations and deltas go to scratch,
+ * which must hold 2 * total_neurons - inputs values. Only ann's weights are
+ * written, so threads may train one ann concurrently (see genann_parallel.h). */
+void genann_train_r(genann const *ann, genann_real const *inputs, genann_real const *desired_outputs, double learning_rate,
+        genann_real *scratch);
+
+/* Number of genann_real values of work space genann_gradient needs for n observations. */
+size_t genann_gradient_work(genann const *ann, int n);
+
+/* Computes the gradient of n observations (row-major) summed into grad
+ * (total_weights long) without changing ann. work must hold
+ * genann_gradient_work(ann, n) values. genann_train_batch adds
+ * learning_rate * grad to the weights. */
+void genann_gradient(genann const *ann, genann_real const *inputs, genann_real const *desired_outputs, int n,
+        genann_real *grad, genann_real *work);
+
+/* Applies weights [first, first + n) of a gradient from genann_gradient with
+ * ann's optimizer, as update number *ann->step, which the caller advances
+ * once per batch beforehand. Threads may update disjoint ranges at once. */
+void genann_update(genann const *ann, genann_real const *grad, double learning_rate, int first, int n);
+
+/* Does one backprop update for a mini-batch of n observations (row-major).
+ * Gradients are summed over the batch into a separate buffer and applied once,
+ * with the same per-observation step size as genann_train, by ann's optimizer.
+ * Returns 0 on success, -1 if scratch memory could not be allocated. */
+int genann_train_batch(genann const *ann, genann_real const *inputs, genann_real const *desired_outputs, int n, double learning_rate);
+
+/* Number of genann_real values of work space genann_train_batch_r needs for
+ * batches of up to n observations. */
+size_t genann_train_batch_work(genann const *ann, int n);
+
+/* genann_train_batch with caller-owned work space, which must hold
+ * genann_train_batch_work(ann, n) values, so a training loop allocates it
+ * once rather than per batch. */
+void genann_train_batch_r(genann const *ann, genann_real const *inputs, genann_real const *desired_outputs, int n,
+        double learning_rate, genann_real *work);
 
 /* Saves the ann. */
 void genann_write(genann const *ann, FILE *out);
 
+/* Saves the ann in the versioned binary format: a header with the topology,
+ * activations, scalar type and a checksum, then the weights, 64-byte aligned.
+ * out must be opened in binary mode. Returns 0 on success, -1 on write error. */
+int genann_write_binary(genann const *ann, FILE *out);
+
+/* Creates ANN from a file saved with genann_write_binary, checking the
+ * checksum. Returns 0 if the file is invalid or was written with a different
+ * genann_real. */
+genann *genann_read_binary(FILE *in);
+
+/* Flag for genann_map: check the weight checksum, touching every page. */
+#define GENANN_MAP_VERIFY 1
+
+/* Maps a file saved with genann_write_binary and uses the weights in place,
+ * without copying. Processes mapping the same file share its pages until they
+ * train. Free with genann_free. Returns 0 if the file is invalid. */
+genann *genann_map(char const *path, int flags);
+
+
+genann_real genann_act_sigmoid(genann_real a);
+genann_real genann_act_sigmoid_cached(genann_real a);
+genann_real genann_act_threshold(genann_real a);
+genann_real genann_act_linear(genann_real a);
+genann_real genann_act_tanh(genann_real a);
+genann_real genann_act_relu(genann_real a);
+
+/* Applies a GENANN_ACT_* function to n pre-activations in place. */
+void genann_act_layer(int activation, genann_real *x, int n);
 
-double genann_act_sigmoid(double a);
-double genann_act_sigmoid_cached(double a);
-double genann_act_threshold(double a);
-double genann_act_linear(double a);
+/* Multiplies d[k] by the derivative of a GENANN_ACT_* function at the neuron
+ * whose output is y[k]. */
+void genann_act_layer_derivative(int activation, genann_real const *y, genann_real *d, int n);
 
 
 #ifdef __cplusplus
@@ -0,0 +1,322 @@
+/*
+ * GENANN - Minimal C Artificial Neural Network
+ *
+ * Copyright (c) 2015, 2016 Lewis Van Winkle
+ *
+ * http://CodePlea.com
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgement in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ */
+
+
+
+#ifndef __GENANN_HPP__
+#define __GENANN_HPP__
+
+/* Fixed-topology networks for C++14 and later. The shape is a template
+ * argument, so every loop bound and offset is a compile-time constant and
+ * small networks compile down to straight-line code:
+ *
+ *     genann_fixed::Network<8, genann_fixed::Layers<3>, 1> net;
+ *     net.load(ann);                      // from a genann of the same shape
+ *     genann_real y = net.run(x)[0];
+ *
+ * Weights are stored exactly as in a genann (per neuron: bias, then one
+ * weight per input), the same activation IDs apply, and run and train match
+ * genann_run and genann_train up to rounding. */
+
+#include "genann.h"
+
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+namespace genann_fixed {
+
+
+/* Widths of the hidden layers, in order. Layers<> has none. */
+template <int... Hidden>
+struct Layers {};
+
+
+/* Offsets of a layer shape, computed at compile time. */
+template <int... Width>
+struct Shape {
+    static constexpr int width(int l) {
+        const int w[] = {Width...};
+        return w[l];
+    }
+
+    static constexpr int neuron_offset(int l) {
+        int offset = 0;
+        for (int k = 0; k < l; ++k) offset += width(k);
+        return offset;
+    }
+
+    static constexpr int weight_offset(int l) {
+        int offset = 0;
+        for (int k = 1; k < l; ++k) offset += (width(k-1) + 1) * width(k);
+        return offset;
+    }
+};
+
+
+template <int Inputs, class Hidden, int Outputs>
+class Network;
+
+
+template <int Inputs, int... Hidden, int Outputs>
+class Network<Inputs, Layers<Hidden...>, Outputs> {
+public:
+    static constexpr int inputs = Inputs;
+    static constexpr int outputs = Outputs;
+    static constexpr int hidden_layers = sizeof...(Hidden);
+    static constexpr int layers = hidden_layers + 2;
+
+    static_assert(Inputs > 0 && Outputs > 0, "a network needs inputs and outputs");
+
+    typedef Shape<Inputs, Hidden..., Outputs> shape;
+
+    /* Neurons in layer l, 0 (inputs) to layers - 1 (outputs). */
+    static constexpr int width(int l) { return shape::width(l); }
+
+    /* Index of layer l's first neuron in the activations, as genann's neuron_offset. */
+    static constexpr int neuron_offset(int l) { return shape::neuron_offset(l); }
+
+    /* Index of the first weight into layer l, as genann's weight_offset. */
+    static constexpr int weight_offset(int l) { return shape::weight_offset(l); }
+
+    static constexpr int total_neurons = shape::neuron_offset(layers);
+    static constexpr int total_weights = shape::weight_offset(layers);
+
+    typedef std::array<genann_real, inputs> input_array;
+    typedef std::array<genann_real, outputs> output_array;
+
+    /* All weights, laid out as genann's weight buffer. */
+    std::array<genann_real, total_weights> weight;
+
+    /* GENANN_ACT_* functions, as in genann. */
+    int activation_hidden = GENANN_ACT_SIGMOID_CACHED;
+    int activation_output = GENANN_ACT_SIGMOID_CACHED;
+
+
+    /* Random weights from -0.5 to 0.5, as genann_init. */
+    Network() {
+        randomize();
+    }
+
+    void randomize() {
+        for (genann_real &w : weight) w = GENANN_RANDOM() - 0.5;
+    }
+
+
+    /* Returns true if ann has exactly this topology. */
+    static bool matches(genann const *ann) {
+        if (!ann || ann->hidden_layers != hidden_layers || ann->total_weights != total_weights) return false;
+        for (int l = 0; l < layers; ++l) {
+            if (ann->width[l] != width(l)) return false;
+        }
+        return true;
+    }
+
+    /* Copies weights and activations from ann. Returns false, leaving this
+     * network unchanged, if the topology differs. */
+    bool load(genann const *ann) {
+        if (!matches(ann)) return false;
+        std::memcpy(weight.data(), ann->weight, sizeof(weight));
+        activation_hidden = ann->activation_hidden;
+        activation_output = ann->activation_output;
+        return true;
+    }
+
+    /* Returns a new genann with these weights, to be freed with genann_free,
+     * or 0 if it could not be allocated. */
+    genann *to_genann() const {
+        static const int widths[layers] = {Inputs, Hidden..., Outputs};
+        genann *ann = genann_init_layers(layers, widths);
+        if (!ann) return 0;
+        std::memcpy(ann->weight, weight.data(), sizeof(weight));
+        ann->activation_hidden = activation_hidden;
+        ann->activation_output = activation_output;
+        return ann;
+    }
+
+    /* Loads a file saved with genann_write. Returns false if it can't be read
+     * or has a different topology. */
+    bool read(FILE *in) {
+        genann *ann = genann_read(in);
+        const bool ok = load(ann);
+        genann_free(ann);
+        return ok;
+    }
+
+    /* Saves in genann_write's format. Returns false if out of memory. */
+    bool write(FILE *out) const {
+        genann *ann = to_genann();
+        if (!ann) return false;
+        genann_write(ann, out);
+        genann_free(ann);
+        return true;
+    }
+
+
+    /* Runs the feedforward algorithm. Reentrant: activations live on the stack. */
+    output_array run(genann_real const *in) const {
+        std::array<genann_real, total_neurons> act;
+        forward(in, act);
+        output_array out;
+        std::memcpy(out.data(), act.data() + neuron_offset(layers - 1), sizeof(out));
+        return out;
+    }
+
+    output_array run(input_array const &in) const {
+        return run(in.data());
+    }
+
+
+    /* Does a single backprop update, as genann_train. */
+    void train(genann_real const *in, genann_real const *desired, double learning_rate) {
+        std::array<genann_real, total_neurons> act;
+        std::array<genann_real, total_neurons> delta;
+        forward(in, act);
+
+        /* Output layer deltas. */
+        constexpr int last = layers - 1;
+        for (int j = 0; j < outputs; ++j) {
+            const genann_real o = act[neuron_offset(last) + j];
+            delta[neuron_offset(last) + j] = (desired[j] - o) * derivative(activation_output, o);
+        }
+
+        backward(act, delta, std::integral_constant<int, last - 1>());
+        update(act, delta, learning_rate, std::integral_constant<int, 1>());
+    }
+
+    void train(input_array const &in, output_array const &desired, double learning_rate) {
+        train(in.data(), desired.data(), learning_rate);
+    }
+
+
+private:
+    typedef std::array<genann_real, total_neurons> activations;
+
+    static genann_real activate(int activation, genann_real a) {
+        switch (activation) {
+            case GENANN_ACT_SIGMOID:
+                if (a < -45.0) return 0;
+                if (a > 45.0) return 1;
+                return 1 / (1 + std::exp(-a));
+            case GENANN_ACT_SIGMOID_CACHED: return genann_act_sigmoid_cached(a);
+            case GENANN_ACT_THRESHOLD: return a > 0;
+            case GENANN_ACT_TANH: return std::tanh(a);
+            case GENANN_ACT_RELU: return a > 0 ? a : 0;
+            case GENANN_ACT_LINEAR:
+            default: return a;
+        }
+    }
+
+    /* Derivative at a neuron whose output is y, as genann_act_layer_derivative. */
+    static genann_real derivative(int activation, genann_real y) {
+        switch (activation) {
+            case GENANN_ACT_SIGMOID:
+            case GENANN_ACT_SIGMOID_CACHED: return y * (1 - y);
+            case GENANN_ACT_THRESHOLD: return 0;
+            case GENANN_ACT_TANH: return 1 - y * y;
+            case GENANN_ACT_RELU: return y > 0;
+            case GENANN_ACT_LINEAR:
+            default: return 1;
+        }
+    }
+
+    int activation_of(int l) const {
+        return l < layers - 1 ? activation_hidden : activation_output;
+    }
+
+
+    void forward(genann_real const *in, activations &act) const {
+        std::memcpy(act.data(), in, sizeof(genann_real) * inputs);
+        forward(act, std::integral_constant<int, 1>());
+    }
+
+    /* Layer L from layer L - 1. Each layer is its own instantiation, so the
+     * bounds below are constants and the loops unroll. */
+    template <int L>
+    void forward(activations &act, std::integral_constant<int, L>) const {
+        constexpr int ins = width(L - 1), outs = width(L);
+        genann_real const *x = act.data() + neuron_offset(L - 1);
+        genann_real *o = act.data() + neuron_offset(L);
+        genann_real const *w = weight.data() + weight_offset(L);
+        const int activation = activation_of(L);
+
+        for (int j = 0; j < outs; ++j, w += ins + 1) {
+            genann_real sum = w[0] * -1.0;
+            for (int k = 0; k < ins; ++k) sum += w[k + 1] * x[k];
+            o[j] = activate(activation, sum);
+        }
+
+        forward(act, std::integral_constant<int, L + 1>());
+    }
+
+    void forward(activations &, std::integral_constant<int, layers>) const {}
+
+
+    /* Hidden layer L deltas from layer L + 1, last hidden layer first. */
+    template <int L>
+    void backward(activations const &act, activations &delta, std::integral_constant<int, L>) const {
+        constexpr int outs = width(L), next = width(L + 1);
+        genann_real const *ww = weight.data() + weight_offset(L + 1);
+        genann_real const *dd = delta.data() + neuron_offset(L + 1);
+        genann_real *d = delta.data() + neuron_offset(L);
+
+        for (int j = 0; j < outs; ++j) d[j] = 0;
+        for (int k = 0; k < next; ++k) {
+            for (int j = 0; j < outs; ++j) d[j] += dd[k] * ww[k * (outs + 1) + 1 + j];
+        }
+        for (int j = 0; j < outs; ++j) d[j] *= derivative(activation_hidden, act[neuron_offset(L) + j]);
+
+        backward(act, delta, std::integral_constant<int, L - 1>());
+    }
+
+    void backward(activations const &, activations &, std::integral_constant<int, 0>) const {}
+
+
+    /* Weights into layer L; every delta is known by now, so order doesn't matter. */
+    template <int L>
+    void update(activations const &act, activations const &delta, double learning_rate, std::integral_constant<int, L>) {
+        constexpr int ins = width(L - 1), outs = width(L);
+        genann_real const *x = act.data() + neuron_offset(L - 1);
+        genann_real const *d = delta.data() + neuron_offset(L);
+        genann_real *w = weight.data() + weight_offset(L);
+
+        for (int j = 0; j < outs; ++j, w += ins + 1) {
+            const genann_real step = d[j] * learning_rate;
+            w[0] += step * -1.0;
+            for (int k = 0; k < ins; ++k) w[k + 1] += step * x[k];
+        }
+
+        update(act, delta, learning_rate, std::integral_constant<int, L + 1>());
+    }
+
+    void update(activations const &, activations const &, double, std::integral_constant<int, layers>) {}
+};
+
+
+}
+
+#endif /*__GENANN_HPP__*/
@@ -0,0 +1,711 @@
+/*
+ * GENANN - Minimal C Artificial Neural Network
+ *
+ * Copyright (c) 2015, 2016 Lewis Van Winkle
+ *
+ * http://CodePlea.com
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgement in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ */
+
+
+
+#include "genann_csv.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define GENANN_HAVE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#define CSV_ALIGN 64
+
+/* Longest number handed to strtod when the fast path can't be exact. */
+#define CSV_TOKEN_MAX 64
+
+/* Bytes read from a stream at a time; grows if a single line is longer. */
+#define STREAM_BLOCK (1 << 20)
+
+
+/* Powers of ten that are exact in a double. */
+static const double pow10_exact[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+
+/* Parses a decimal number in [p, end) and returns the first character after
+ * it, or 0 if there is none. Numbers with up to 15 significant digits and a
+ * small exponent are exact from one multiply or divide (Clinger's fast
+ * path); anything else goes through strtod. */
+static char const *parse_number(char const *p, char const *end, double *out) {
+    char const *const start = p;
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0, any = 0, negative = 0;
+
+    if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+    for (; p < end && *p >= '0' && *p <= '9'; ++p, any = 1) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            if (mantissa) ++digits;
+        } else {
+            ++exponent;
+        }
+    }
+
+    if (p < end && *p == '.') {
+        for (++p; p < end && *p >= '0' && *p <= '9'; ++p, any = 1) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                if (mantissa) ++digits;
+                --exponent;
+            }
+        }
+    }
+
+    if (!any) return 0;
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        char const *q = p + 1;
+        int e = 0, eneg = 0, edigits = 0;
+        if (q < end && (*q == '-' || *q == '+')) eneg = *q++ == '-';
+        for (; q < end && *q >= '0' && *q <= '9'; ++q, ++edigits) {
+            if (e < 100000) e = e * 10 + (*q - '0');
+        }
+        if (edigits) {
+            exponent += eneg ? -e : e;
+            p = q;
+        }
+    }
+
+    if (mantissa < ((uint64_t)1 << 53) && exponent >= -22 && exponent <= 22) {
+        const double m = (double)mantissa;
+        *out = exponent < 0 ? m / pow10_exact[-exponent] : m * pow10_exact[exponent];
+        if (negative) *out = -*out;
+        return p;
+    }
+
+    /* Too many digits or too large an exponent to round correctly here. */
+    char token[CSV_TOKEN_MAX];
+    const size_t length = p - start;
+    if (length >= sizeof(token)) return 0;
+    memcpy(token, start, length);
+    token[length] = 0;
+    *out = strtod(token, 0);
+    return p;
+}
+
+
+static int is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+
+/* Returns 1 if [p, end) holds only blanks. */
+static int blank_line(char const *p, char const *end) {
+    for (; p < end; ++p) {
+        if (!is_blank(*p)) return 0;
+    }
+    return 1;
+}
+
+
+/* Parses one line of columns fields into x (every field but the label) and
+ * *y (the label). Returns 0 on success, -1 if a field isn't a number or the
+ * field count is wrong. */
+static int parse_line(char const *p, char const *line_end, char delimiter, int columns, int label,
+        genann_real *x, genann_real *y) {
+    int column;
+    for (column = 0; column < columns; ++column) {
+        double v;
+        while (p < line_end && is_blank(*p) && *p != delimiter) ++p;
+        p = parse_number(p, line_end, &v);
+        if (!p) return -1;
+        while (p < line_end && is_blank(*p) && *p != delimiter) ++p;
+
+        if (column == label) *y = (genann_real)v;
+        else *x++ = (genann_real)v;
+
+        /* Each field but the last ends at a delimiter; the last at the end of the line. */
+        if (column + 1 < columns) {
+            if (p >= line_end || *p != delimiter) return -1;
+            ++p;
+        } else if (p != line_end) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+typedef struct csv_job {
+    char const *text;
+    size_t size;
+    char delimiter;
+    int columns, label;
+    genann_csv *csv;
+
+    /* Per chunk: byte range, rows found by the first pass, first row index
+     * and failure flag from the second. */
+    size_t *begin;
+    int *rows;
+    int *first;
+    int *failed;
+} csv_job;
+
+
+/* Chunk boundaries fall just after a newline, so no line is split. */
+static void chunk_range(csv_job const *job, int index, int count, char const **lo, char const **hi) {
+    int k;
+    for (k = 0; k < 2; ++k) {
+        size_t at = job->size * (size_t)(index + k) / count;
+        if (index + k == count) {
+            at = job->size;
+        } else if (index + k > 0) {
+            char const *nl = memchr(job->text + at, '\n', job->size - at);
+            at = nl ? (size_t)(nl - job->text) + 1 : job->size;
+        } else {
+            at = job->begin[0];
+        }
+        if (at < job->begin[0]) at = job->begin[0];
+        *(k ? hi : lo) = job->text + at;
+    }
+}
+
+
+/* First pass: count the observations in one chunk. */
+static void count_rows(void *ctx, int index, int count) {
+    csv_job *job = ctx;
+    char const *p, *end;
+    chunk_range(job, index, count, &p, &end);
+
+    int rows = 0;
+    while (p < end) {
+        char const *nl = memchr(p, '\n', end - p);
+        char const *line_end = nl ? nl : end;
+        if (!blank_line(p, line_end)) ++rows;
+        p = line_end + 1;
+    }
+    job->rows[index] = rows;
+}
+
+
+/* Second pass: parse one chunk into its rows of the matrix. */
+static void parse_rows(void *ctx, int index, int count) {
+    csv_job *job = ctx;
+    genann_csv *csv = job->csv;
+    char const *p, *end;
+    chunk_range(job, index, count, &p, &end);
+
+    int row = job->first[index];
+    while (p < end) {
+        char const *nl = memchr(p, '\n', end - p);
+        char const *line_end = nl ? nl : end;
+
+        if (!blank_line(p, line_end)) {
+            if (parse_line(p, line_end, job->delimiter, job->columns, job->label,
+                        csv->data + (size_t)row * csv->features, csv->labels + row) != 0) {
+                job->failed[index] = 1;
+                return;
+            }
+            ++row;
+        }
+
+        p = line_end + 1;
+    }
+}
+
+
+static void run(genann_threads *threads, genann_task task, void *ctx) {
+    if (threads) genann_threads_run(threads, task, ctx);
+    else task(ctx, 0, 1);
+}
+
+
+/* Counts the fields of the first non-blank line. Returns 0 if it is a
+ * header, that is, doesn't start with a number; 1 otherwise. */
+static int first_line(char const *p, char const *line_end, char delimiter, int *columns) {
+    char const *q;
+    *columns = 1;
+    for (q = p; q < line_end; ++q) {
+        if (*q == delimiter) ++*columns;
+    }
+
+    double v;
+    while (p < line_end && is_blank(*p) && *p != delimiter) ++p;
+    return parse_number(p, line_end, &v) != 0;
+}
+
+
+/* Parses a whole file already in memory. */
+static genann_csv *csv_parse(char const *text, size_t size, int label_column, char delimiter, genann_threads *threads) {
+    /* The first non-blank line fixes the number of columns. */
+    size_t begin = 0;
+    char const *line_end;
+    for (;;) {
+        if (begin >= size) return 0;
+        char const *nl = memchr(text + begin, '\n', size - begin);
+        line_end = nl ? nl : text + size;
+        if (!blank_line(text + begin, line_end)) break;
+        begin = line_end - text + 1;
+    }
+
+    int columns;
+    if (!first_line(text + begin, line_end, delimiter, &columns)) begin = line_end - text + 1;
+
+    const int label = label_column < 0 ? columns + label_column : label_column;
+    if (columns < 2 || label < 0 || label >= columns) return 0;
+
+    const int chunks = threads ? genann_threads_count(threads) : 1;
+    csv_job job;
+    job.text = text;
+    job.size = size;
+    job.delimiter = delimiter;
+    job.columns = columns;
+    job.label = label;
+    job.csv = 0;
+
+    job.begin = calloc(chunks + 1, sizeof(size_t) + 3 * sizeof(int));
+    if (!job.begin) return 0;
+    job.rows = (int*)(job.begin + chunks + 1);
+    job.first = job.rows + chunks;
+    job.failed = job.first + chunks;
+    job.begin[0] = begin;
+
+    run(threads, count_rows, &job);
+
+    size_t rows = 0;
+    int k;
+    for (k = 0; k < chunks; ++k) {
+        job.first[k] = (int)rows;
+        rows += job.rows[k];
+    }
+
+    /* Struct, then the matrix and labels, each on its own cache line. */
+    const int features = columns - 1;
+    const size_t data_size = sizeof(genann_real) * rows * features;
+    const size_t labels_at = (data_size + CSV_ALIGN - 1) / CSV_ALIGN * CSV_ALIGN;
+    genann_csv *csv = rows && rows < INT32_MAX ? malloc(sizeof(genann_csv) + CSV_ALIGN + labels_at + sizeof(genann_real) * rows) : 0;
+    if (!csv) {
+        free(job.begin);
+        return 0;
+    }
+
+    csv->rows = (int)rows;
+    csv->features = features;
+    csv->data = (genann_real*)(((uintptr_t)(csv + 1) + CSV_ALIGN - 1) & ~(uintptr_t)(CSV_ALIGN - 1));
+    csv->labels = (genann_real*)((char*)csv->data + labels_at);
+
+    job.csv = csv;
+    run(threads, parse_rows, &job);
+
+    for (k = 0; k < chunks; ++k) {
+        if (job.failed[k]) {
+            free(csv);
+            csv = 0;
+            break;
+        }
+    }
+
+    free(job.begin);
+    return csv;
+}
+
+
+genann_csv *genann_csv_load(char const *path, int label_column, char delimiter, genann_threads *threads) {
+    genann_csv *csv = 0;
+
+#ifdef GENANN_HAVE_MMAP
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+
+    const size_t size = st.st_size;
+    void *map = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return 0;
+
+    /* Read front to back once per pass. */
+    posix_madvise(map, size, POSIX_MADV_SEQUENTIAL);
+
+    csv = csv_parse(map, size, label_column, delimiter, threads);
+    munmap(map, size);
+#else
+    FILE *in = fopen(path, "rb");
+    if (!in) return 0;
+
+    char *text = 0;
+    long size = -1;
+    if (fseek(in, 0, SEEK_END) == 0) size = ftell(in);
+    if (size > 0 && fseek(in, 0, SEEK_SET) == 0) text = malloc(size);
+    if (text && fread(text, 1, size, in) == (size_t)size) {
+        csv = csv_parse(text, size, label_column, delimiter, threads);
+    }
+
+    free(text);
+    fclose(in);
+#endif
+
+    return csv;
+}
+
+
+void genann_csv_free(genann_csv *csv) {
+    /* The matrix and labels live in the same allocation. */
+    free(csv);
+}
+
+
+
+/* Streaming: a reader thread fills two chunk buffers in turn and the caller
+ * consumes them in the same order. A chunk is EMPTY while the reader owns it
+ * and READY once the caller may take it; the caller hands it back on its
+ * next call. */
+
+#define CHUNK_EMPTY 0
+#define CHUNK_READY 1
+
+struct genann_csv_stream {
+    FILE *in;
+    char delimiter;
+    int columns, label, features, chunk_rows;
+
+    /* Byte offset of the first observation, after any header. */
+    long start;
+
+    /* Shuffle state, 0 if chunks keep file order. */
+    uint64_t seed;
+
+    /* Text read from the file but not parsed yet: [pos, used) of text,
+     * which starts at byte base of the file. */
+    char *text;
+    size_t pos, used, cap;
+    long base;
+    int eof;
+
+    /* Set when the text can't be grown or the file can't be read; unlike
+     * eof it is never cleared. */
+    int error;
+
+    /* The two chunks. rows is -1 after a parse error, -2 after a read error
+     * and 0 at the end of an epoch. */
+    genann_real *data[2];
+    genann_real *labels[2];
+    int rows[2];
+    int state[2];
+
+    /* Chunk the caller takes next, and chunk it holds now (-1 if none). */
+    int next, held;
+
+    double stall;
+    int stop;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+
+static double stream_now(void) {
+#if defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+
+/* Reads more text, keeping the unparsed tail. Returns 0 at end of file, or
+ * with error set if it failed. */
+static int stream_fill(genann_csv_stream *s) {
+    if (s->eof || s->error) return 0;
+
+    memmove(s->text, s->text + s->pos, s->used - s->pos);
+    s->base += (long)s->pos;
+    s->used -= s->pos;
+    s->pos = 0;
+
+    /* Only the unparsed tail is left and it is one partial line: grow. */
+    if (s->used == s->cap) {
+        char *text = realloc(s->text, s->cap * 2);
+        if (!text) {
+            s->error = 1;
+            return 0;
+        }
+        s->text = text;
+        s->cap *= 2;
+    }
+
+    const size_t got = fread(s->text + s->used, 1, s->cap - s->used, s->in);
+    s->used += got;
+    if (got == 0) {
+        if (ferror(s->in)) s->error = 1;
+        else s->eof = 1;
+    }
+    return got != 0;
+}
+
+
+/* Finds the next line in the text, reading as needed. Returns 0 once the
+ * file is exhausted or can't be read. */
+static int stream_line(genann_csv_stream *s, char const **line, char const **line_end) {
+    for (;;) {
+        char const *nl = memchr(s->text + s->pos, '\n', s->used - s->pos);
+        if (nl) {
+            *line = s->text + s->pos;
+            *line_end = nl;
+            s->pos = nl - s->text + 1;
+            return 1;
+        }
+        if (!stream_fill(s)) {
+            /* A last line without a newline; a partial one is not a line. */
+            if (s->error || s->pos == s->used) return 0;
+            *line = s->text + s->pos;
+            *line_end = s->text + s->used;
+            s->pos = s->used;
+            return 1;
+        }
+    }
+}
+
+
+static uint64_t stream_random(genann_csv_stream *s) {
+    /* xorshift64* */
+    s->seed ^= s->seed >> 12;
+    s->seed ^= s->seed << 25;
+    s->seed ^= s->seed >> 27;
+    return s->seed * 2685821657736338717ull;
+}
+
+
+/* Fills chunk c with up to chunk_rows observations. At the end of the file
+ * the chunk gets 0 rows, marking the end of the epoch, and the file is
+ * rewound for the next one. */
+static void stream_chunk(genann_csv_stream *s, int c) {
+    genann_real *x = s->data[c], *y = s->labels[c];
+    char const *line, *line_end;
+    int rows = 0;
+
+    while (rows < s->chunk_rows && stream_line(s, &line, &line_end)) {
+        if (blank_line(line, line_end)) continue;
+        if (parse_line(line, line_end, s->delimiter, s->columns, s->label,
+                    x + (size_t)rows * s->features, y + rows) != 0) {
+            s->rows[c] = -1;
+            return;
+        }
+        ++rows;
+    }
+
+    /* Not the end of the epoch: the rest of the file was never seen. */
+    if (s->error) {
+        s->rows[c] = -2;
+        return;
+    }
+
+    if (rows == 0) {
+        fseek(s->in, s->start, SEEK_SET);
+        s->base = s->start;
+        s->pos = s->used = 0;
+        s->eof = 0;
+    }
+
+    /* Fisher-Yates within the chunk. */
+    if (s->seed) {
+        int i;
+        for (i = rows - 1; i > 0; --i) {
+            const int j = (int)(stream_random(s) % (uint64_t)(i + 1));
+            genann_real *a = x + (size_t)i * s->features, *b = x + (size_t)j * s->features;
+            int k;
+            for (k = 0; k < s->features; ++k) {
+                const genann_real t = a[k]; a[k] = b[k]; b[k] = t;
+            }
+            const genann_real t = y[i]; y[i] = y[j]; y[j] = t;
+        }
+    }
+
+    s->rows[c] = rows;
+}
+
+
+static void *stream_reader(void *arg) {
+    genann_csv_stream *s = arg;
+    int c = 0;
+
+    pthread_mutex_lock(&s->lock);
+    for (;;) {
+        while (s->state[c] != CHUNK_EMPTY && !s->stop) {
+            pthread_cond_wait(&s->cond, &s->lock);
+        }
+        if (s->stop) break;
+        pthread_mutex_unlock(&s->lock);
+
+        stream_chunk(s, c);
+
+        pthread_mutex_lock(&s->lock);
+        s->state[c] = CHUNK_READY;
+        pthread_cond_broadcast(&s->cond);
+
+        /* After an error there is nothing more to read. */
+        if (s->rows[c] < 0) break;
+        c ^= 1;
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return 0;
+}
+
+
+genann_csv_stream *genann_csv_stream_open(char const *path, int label_column, char delimiter, int chunk_rows, unsigned seed) {
+    if (chunk_rows < 1) return 0;
+
+    genann_csv_stream *s = calloc(1, sizeof(genann_csv_stream));
+    if (!s) return 0;
+
+    s->in = fopen(path, "rb");
+    s->cap = STREAM_BLOCK;
+    s->text = malloc(s->cap);
+    if (!s->in || !s->text) goto fail;
+
+    /* The first non-blank line fixes the number of columns. */
+    char const *line, *line_end;
+    do {
+        if (!stream_line(s, &line, &line_end)) goto fail;
+    } while (blank_line(line, line_end));
+
+    /* Start after a header, or at the first line. */
+    s->start = s->base + (long)(first_line(line, line_end, delimiter, &s->columns) ? (size_t)(line - s->text) : s->pos);
+    s->label = label_column < 0 ? s->columns + label_column : label_column;
+    if (s->columns < 2 || s->label < 0 || s->label >= s->columns) goto fail;
+
+    s->delimiter = delimiter;
+    s->features = s->columns - 1;
+    s->chunk_rows = chunk_rows;
+    s->seed = seed;
+    s->held = -1;
+
+    fseek(s->in, s->start, SEEK_SET);
+    s->base = s->start;
+    s->pos = s->used = 0;
+    s->eof = 0;
+
+    int c;
+    for (c = 0; c < 2; ++c) {
+        s->data[c] = malloc(sizeof(genann_real) * ((size_t)chunk_rows * s->features + chunk_rows));
+        if (!s->data[c]) goto fail;
+        s->labels[c] = s->data[c] + (size_t)chunk_rows * s->features;
+    }
+
+    pthread_mutex_init(&s->lock, 0);
+    pthread_cond_init(&s->cond, 0);
+    if (pthread_create(&s->thread, 0, stream_reader, s) != 0) {
+        pthread_cond_destroy(&s->cond);
+        pthread_mutex_destroy(&s->lock);
+        goto fail;
+    }
+
+    return s;
+
+fail:
+    if (s->in) fclose(s->in);
+    free(s->data[0]);
+    free(s->data[1]);
+    free(s->text);
+    free(s);
+    return 0;
+}
+
+
+int genann_csv_stream_features(genann_csv_stream const *s) {
+    return s->features;
+}
+
+
+int genann_csv_stream_next(genann_csv_stream *s, genann_real **data, genann_real **labels) {
+    pthread_mutex_lock(&s->lock);
+
+    /* Hand the previous chunk back to the reader. */
+    if (s->held >= 0) {
+        s->state[s->held] = CHUNK_EMPTY;
+        s->held = -1;
+        pthread_cond_broadcast(&s->cond);
+    }
+
+    const int c = s->next;
+    if (s->state[c] != CHUNK_READY) {
+        const double t0 = stream_now();
+        while (s->state[c] != CHUNK_READY) {
+            pthread_cond_wait(&s->cond, &s->lock);
+        }
+        s->stall += stream_now() - t0;
+    }
+
+    const int rows = s->rows[c];
+
+    /* An error stays ready, so every later call reports it too. */
+    if (rows >= 0) {
+        s->held = c;
+        s->next = c ^ 1;
+    }
+
+    pthread_mutex_unlock(&s->lock);
+
+    *data = s->data[c];
+    *labels = s->labels[c];
+    return rows;
+}
+
+
+double genann_csv_stream_stall(genann_csv_stream const *s) {
+    return s->stall;
+}
+
+
+void genann_csv_stream_close(genann_csv_stream *s) {
+    if (!s) return;
+
+    pthread_mutex_lock(&s->lock);
+    s->stop = 1;
+    pthread_cond_broadcast(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+    pthread_join(s->thread, 0);
+
+    pthread_cond_destroy(&s->cond);
+    pthread_mutex_destroy(&s->lock);
+    fclose(s->in);
+    free(s->data[0]);
+    free(s->data[1]);
+    free(s->text);
+    free(s);
+}
@@ -0,0 +1,100 @@
+/*
+ * GENANN - Minimal C Artificial Neural Network
+ *
+ * Copyright (c) 2015, 2016 Lewis Van Winkle
+ *
+ * http://CodePlea.com
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgement in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ */
+
+
+
+#ifndef __GENANN_CSV_H__
+#define __GENANN_CSV_H__
+
+#include "genann.h"
+#include "genann_threads.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* A delimited text file of numbers loaded into memory: every column but the
+ * label goes into one contiguous feature matrix, the label into a vector. */
+typedef struct genann_csv {
+    /* Number of observations, and feature columns in each. */
+    int rows, features;
+
+    /* Features, row-major (rows * features long). 64-byte aligned. */
+    genann_real *data;
+
+    /* Label of each observation (rows long). */
+    genann_real *labels;
+
+} genann_csv;
+
+
+/* Loads a file with one observation per line and fields separated by
+ * delimiter. label_column picks the label; negative values count from the
+ * end, so -1 is the last column. The row count is inferred. Blank lines are
+ * skipped, and so is a first line that doesn't start with a number (a
+ * header). The file is mapped and parsed in one chunk per thread; threads may
+ * be 0 to parse on the calling thread. Returns 0 if the file can't be read,
+ * a field isn't a number, or a row has the wrong number of fields. */
+genann_csv *genann_csv_load(char const *path, int label_column, char delimiter, genann_threads *threads);
+
+/* Frees the memory used by a loaded file. */
+void genann_csv_free(genann_csv *csv);
+
+
+/* A file read in chunks by a background thread, for data that doesn't fit
+ * in memory. While the caller trains on one chunk the reader parses the next
+ * into a second buffer. */
+typedef struct genann_csv_stream genann_csv_stream;
+
+/* Opens a file in the format genann_csv_load reads, to be read chunk_rows
+ * observations at a time. If seed is nonzero each chunk is shuffled before
+ * it is handed out; the order never crosses chunks. Returns 0 if the file
+ * can't be opened or its first line is unusable. */
+genann_csv_stream *genann_csv_stream_open(char const *path, int label_column, char delimiter, int chunk_rows, unsigned seed);
+
+/* Number of feature columns in each observation. */
+int genann_csv_stream_features(genann_csv_stream const *s);
+
+/* Waits for the next chunk and points data (rows * features) and labels
+ * (rows) at it. They stay valid, and may be modified, until the next call.
+ * Returns the number of rows; 0 at the end of each pass over the file, after
+ * which the next call starts a new pass; -1 if a row can't be parsed; -2 if
+ * the file can't be read or a line doesn't fit in memory. After an error
+ * every later call returns it again. */
+int genann_csv_stream_next(genann_csv_stream *s, genann_real **data, genann_real **labels);
+
+/* Total seconds genann_csv_stream_next has spent waiting for the reader. */
+double genann_csv_stream_stall(genann_csv_stream const *s);
+
+/* Stops the reader and frees the stream. */
+void genann_csv_stream_close(genann_csv_stream *s);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*__GENANN_CSV_H__*/
@@ -0,0 +1,328 @@
+/*
+ * GENANN - Minimal C Artificial Neural Network
+ *
+ * Copyright (c) 2015, 2016 Lewis Van Winkle
+ *
+ * http://CodePlea.com
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgement in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ */
+
+
+#include "genann_eval.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+
+
+/* Probabilities are clamped to [LOG_CLAMP, 1 - LOG_CLAMP] for the log loss. */
+#define LOG_CLAMP 1e-15
+
+/* Each thread's counts start on their own cache line, so the workers don't
+ * contend for lines they never share data on. */
+#define CACHE_LINE 64
+
+
+typedef struct ranked {
+    genann_real score;
+    int positive;
+} ranked;
+
+
+/* What one thread has counted over its rows, followed in memory by its
+ * confusion counts. nan counts NaN scores in the AUC column being ranked. */
+typedef struct eval_part {
+    double log_loss, squared_error;
+    long *confusion;
+    int failed, nan;
+} eval_part;
+
+
+typedef struct eval_job {
+    genann const *ann;
+    genann_real const *inputs;
+    genann_real const *desired_outputs;
+    int n, classes;
+
+    /* Outputs (n rows) and actual class of each observation. */
+    genann_real *outputs;
+    int *actual;
+
+    /* Per thread parts, part_stride bytes apart. */
+    char *part;
+    size_t part_stride;
+
+    /* The AUC column being ranked, sorted in one run per thread, and the
+     * next unmerged row of each run. */
+    ranked *rank;
+    int *head;
+    int column;
+} eval_job;
+
+
+static eval_part *part_of(eval_job const *job, int index) {
+    return (eval_part*)(job->part + job->part_stride * index);
+}
+
+
+static void run(genann_threads *threads, genann_task task, void *ctx) {
+    if (threads) genann_threads_run(threads, task, ctx);
+    else task(ctx, 0, 1);
+}
+
+
+/* Splits count items evenly over threads; thread index gets [*lo, *hi). */
+static void share(int count, int index, int threads, int *lo, int *hi) {
+    *lo = (int)((long long)count * index / threads);
+    *hi = (int)((long long)count * (index + 1) / threads);
+}
+
+
+static int argmax(genann_real const *x, int n) {
+    int k, best = 0;
+    for (k = 1; k < n; ++k) {
+        if (x[k] > x[best]) best = k;
+    }
+    return best;
+}
+
+
+static double clamp(double p) {
+    return p < LOG_CLAMP ? LOG_CLAMP : p > 1 - LOG_CLAMP ? 1 - LOG_CLAMP : p;
+}
+
+
+/* Runs this thread's rows as one batch, then scores them. */
+static void eval_rows(void *ctx, int index, int threads) {
+    eval_job const *job = ctx;
+    genann const *ann = job->ann;
+    eval_part *part = part_of(job, index);
+    const int outputs = ann->outputs, classes = job->classes;
+
+    int lo, hi, i, k;
+    share(job->n, index, threads, &lo, &hi);
+    if (hi == lo) return;
+
+    genann_real *o = job->outputs + (size_t)lo * outputs;
+    if (genann_run_batch(ann, job->inputs + (size_t)lo * ann->inputs, hi - lo, o) != 0) {
+        part->failed = 1;
+        return;
+    }
+
+    genann_real const *t = job->desired_outputs + (size_t)lo * outputs;
+    for (i = lo; i < hi; ++i, o += outputs, t += outputs) {
+        for (k = 0; k < outputs; ++k) {
+            const double e = t[k] - o[k];
+            part->squared_error += e * e;
+        }
+
+        int actual, predicted;
+        if (outputs == 1) {
+            actual = t[0] > 0.5;
+            predicted = o[0] > 0.5;
+            const double p = clamp(o[0]);
+            part->log_loss -= t[0] * log(p) + (1 - t[0]) * log(1 - p);
+        } else {
+            actual = argmax(t, outputs);
+            predicted = argmax(o, outputs);
+            double sum = 0;
+            for (k = 0; k < outputs; ++k) sum += o[k];
+            part->log_loss -= log(clamp(sum > 0 ? o[actual] / sum : 0));
+        }
+
+        job->actual[i] = actual;
+        ++part->confusion[actual * classes + predicted];
+    }
+}
+
+
+/* NaN sorts after every number and ties with itself, so the order stays
+ * consistent for qsort. */
+static int compare_ranked(void const *a, void const *b) {
+    const genann_real x = ((ranked const*)a)->score, y = ((ranked const*)b)->score;
+    if (x != x || y != y) return (x != x) - (y != y);
+    return (x > y) - (x < y);
+}
+
+
+/* Fills and sorts this thread's rows of the AUC column, counting NaN scores. */
+static void sort_rows(void *ctx, int index, int threads) {
+    eval_job const *job = ctx;
+    eval_part *part = part_of(job, index);
+    const int outputs = job->ann->outputs;
+    const int positive = outputs == 1 ? 1 : job->column;
+
+    int lo, hi, i;
+    share(job->n, index, threads, &lo, &hi);
+
+    part->nan = 0;
+    for (i = lo; i < hi; ++i) {
+        job->rank[i].score = job->outputs[(size_t)i * outputs + job->column];
+        job->rank[i].positive = job->actual[i] == positive;
+        if (job->rank[i].score != job->rank[i].score) ++part->nan;
+    }
+    qsort(job->rank + lo, hi - lo, sizeof(ranked), compare_ranked);
+}
+
+
+/* Merges the sorted runs in ascending score order and counts, for every
+ * positive, the negatives ranked below it; ties count half. Returns -1 if
+ * the column has no positives or no negatives. The column must hold no NaN,
+ * which never ties with itself. */
+static double merge_auc(eval_job const *job, int threads) {
+    int *lo = job->head, *hi = job->head + threads, t;
+    for (t = 0; t < threads; ++t) share(job->n, t, threads, lo + t, hi + t);
+
+    double pairs = 0, negatives = 0, positives = 0;
+    for (;;) {
+        /* Find the lowest score left, then take every row that has it. */
+        int first = -1;
+        for (t = 0; t < threads; ++t) {
+            if (lo[t] < hi[t] && (first < 0 || job->rank[lo[t]].score < job->rank[lo[first]].score)) first = t;
+        }
+        if (first < 0) break;
+
+        const genann_real score = job->rank[lo[first]].score;
+        double pos = 0, neg = 0;
+        for (t = 0; t < threads; ++t) {
+            for (; lo[t] < hi[t] && job->rank[lo[t]].score == score; ++lo[t]) {
+                if (job->rank[lo[t]].positive) ++pos;
+                else ++neg;
+            }
+        }
+
+        pairs += pos * negatives + 0.5 * pos * neg;
+        negatives += neg;
+        positives += pos;
+    }
+
+    return positives > 0 && negatives > 0 ? pairs / (positives * negatives) : -1;
+}
+
+
+genann_metrics *genann_evaluate(genann const *ann, genann_threads *threads,
+        genann_real const *inputs, genann_real const *desired_outputs, int n) {
+    if (n < 1) return 0;
+
+    const int classes = ann->outputs == 1 ? 2 : ann->outputs;
+    const int count = threads ? genann_threads_count(threads) : 1;
+
+    /* The result and its tables in one block. */
+    genann_metrics *ret = malloc(sizeof(genann_metrics) + (sizeof(long) + 2 * sizeof(double)) * classes * classes);
+    if (!ret) return 0;
+    ret->confusion = (long*)((char*)ret + sizeof(genann_metrics));
+    ret->precision = (double*)(ret->confusion + classes * classes);
+    ret->recall = ret->precision + classes;
+
+    /* Work space: outputs, actual classes, ranks, and per thread counts. */
+    eval_job job;
+    job.ann = ann;
+    job.inputs = inputs;
+    job.desired_outputs = desired_outputs;
+    job.n = n;
+    job.classes = classes;
+    job.outputs = malloc(sizeof(genann_real) * n * ann->outputs);
+    job.actual = malloc(sizeof(int) * n);
+    job.rank = malloc(sizeof(ranked) * n);
+    job.head = malloc(sizeof(int) * 2 * count);
+
+    /* Each part and its confusion counts, in whole cache lines. */
+    job.part_stride = (sizeof(eval_part) + sizeof(long) * classes * classes + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    void *parts = calloc(job.part_stride * count + CACHE_LINE, 1);
+    job.part = (char*)(((uintptr_t)parts + CACHE_LINE - 1) & ~(uintptr_t)(CACHE_LINE - 1));
+
+    int t, a, p;
+    int failed = !job.outputs || !job.actual || !job.rank || !job.head || !parts;
+
+    if (!failed) {
+        for (t = 0; t < count; ++t) part_of(&job, t)->confusion = (long*)(part_of(&job, t) + 1);
+        run(threads, eval_rows, &job);
+        for (t = 0; t < count; ++t) failed |= part_of(&job, t)->failed;
+    }
+
+    if (failed) {
+        free(job.outputs);
+        free(job.actual);
+        free(job.rank);
+        free(job.head);
+        free(parts);
+        free(ret);
+        return 0;
+    }
+
+    /* Sum the per thread counts. */
+    ret->count = n;
+    ret->classes = classes;
+    ret->log_loss = ret->mse = 0;
+    memset(ret->confusion, 0, sizeof(long) * classes * classes);
+    for (t = 0; t < count; ++t) {
+        eval_part const *part = part_of(&job, t);
+        ret->log_loss += part->log_loss;
+        ret->mse += part->squared_error;
+        for (a = 0; a < classes * classes; ++a) ret->confusion[a] += part->confusion[a];
+    }
+    ret->log_loss /= n;
+    ret->mse /= (double)n * ann->outputs;
+
+    long correct = 0;
+    for (a = 0; a < classes; ++a) {
+        long predicted = 0, actual = 0;
+        for (p = 0; p < classes; ++p) {
+            predicted += ret->confusion[p * classes + a];
+            actual += ret->confusion[a * classes + p];
+        }
+        const long hits = ret->confusion[a * classes + a];
+        correct += hits;
+        ret->precision[a] = predicted ? (double)hits / predicted : 0;
+        ret->recall[a] = actual ? (double)hits / actual : 0;
+    }
+    ret->accuracy = (double)correct / n;
+
+    /* One AUC column for a binary classifier, one per class otherwise. Each
+     * thread sorts its own rows; the runs are merged on this thread. A NaN
+     * score has no rank, so it leaves the AUC undefined. */
+    double auc = 0;
+    int columns = 0, nan = 0;
+    for (job.column = 0; job.column < ann->outputs; ++job.column) {
+        run(threads, sort_rows, &job);
+
+        for (t = 0; t < count; ++t) nan += part_of(&job, t)->nan;
+        if (nan) break;
+
+        const double c = merge_auc(&job, count);
+        if (c >= 0) {
+            auc += c;
+            ++columns;
+        }
+    }
+    ret->auc = columns && !nan ? auc / columns : -1;
+
+    free(job.outputs);
+    free(job.actual);
+    free(job.rank);
+    free(job.head);
+    free(parts);
+    return ret;
+}
+
+
+void genann_metrics_free(genann_metrics *metrics) {
+    free(metrics);
+}
@@ -0,0 +1,84 @@
+/*
+ * GENANN - Minimal C Artificial Neural Network
+ *
+ * Copyright (c) 2015, 2016 Lewis Van Winkle
+ *
+ * http://CodePlea.com
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgement in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ */
+
+
+#ifndef __GENANN_EVAL_H__
+#define __GENANN_EVAL_H__
+
+#include "genann.h"
+#include "genann_threads.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Scores of an ann on a labelled dataset. An ann with one output is a binary
+ * classifier thresholded at 0.5; with more outputs, the predicted and actual
+ * classes are the largest output and the largest desired output. */
+typedef struct genann_metrics {
+    /* Observations scored, and classes (2 for a single output, else outputs). */
+    int count, classes;
+
+    /* Fraction classified correctly. */
+    double accuracy;
+
+    /* Mean cross entropy. Outputs are clamped away from 0 and 1; with more
+     * than one output they are first scaled to sum to 1. */
+    double log_loss;
+
+    /* Mean squared error over all outputs, as genann_loss. */
+    double mse;
+
+    /* Area under the ROC curve; the mean over classes of one-vs-rest AUC with
+     * more than one output. -1 if no class has both positives and negatives,
+     * or if any output is NaN. */
+    double auc;
+
+    /* Counts, confusion[actual * classes + predicted]. */
+    long *confusion;
+
+    /* Per class, 0 where undefined. */
+    double *precision;
+    double *recall;
+
+} genann_metrics;
+
+
+/* Scores n observations (row-major) and their desired outputs, split over
+ * threads (which may be null to run on the caller only). Nothing is printed
+ * and ann is only read. Returns 0 on allocation failure or if n < 1. */
+genann_metrics *genann_evaluate(genann const *ann, genann_threads *threads,
+        genann_real const *inputs, genann_real const *desired_outputs, int n);
+
+/* Frees the memory used by a set of metrics. */
+void genann_metrics_free(genann_metrics *metrics);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*__GENANN_EVAL_H__*/
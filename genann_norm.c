@@ -0,0 +1,211 @@
+/*
+ * GENANN - Minimal C Artificial Neural Network
+ *
+ * Copyright (c) 2015, 2016 Lewis Van Winkle
+ *
+ * http://CodePlea.com
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgement in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ */
+
+
+
+#include "genann_norm.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+
+genann_norm *genann_norm_init(int features, int mode) {
+    if (features < 1) return 0;
+    if (mode != GENANN_NORM_ZSCORE && mode != GENANN_NORM_MINMAX) return 0;
+
+    /* Statistics first so they stay aligned, transform after. */
+    const size_t size = sizeof(genann_norm) + (sizeof(double) * 2 + sizeof(genann_real) * 2) * features;
+    genann_norm *ret = malloc(size);
+    if (!ret) return 0;
+
+    ret->features = features;
+    ret->mode = mode;
+    ret->count = 0;
+
+    /* Set pointers. */
+    ret->stat0 = (double*)((char*)ret + sizeof(genann_norm));
+    ret->stat1 = ret->stat0 + features;
+    ret->shift = (genann_real*)(ret->stat1 + features);
+    ret->scale = ret->shift + features;
+
+    int k;
+    for (k = 0; k < features; ++k) {
+        ret->stat0[k] = ret->stat1[k] = 0;
+        ret->shift[k] = 0;
+        ret->scale[k] = 1;
+    }
+
+    return ret;
+}
+
+
+void genann_norm_add(genann_norm *norm, genann_real const *data, int n) {
+    if (n < 1) return;
+
+    const int features = norm->features;
+    int k, s;
+
+    if (norm->mode == GENANN_NORM_MINMAX) {
+        double *lo = norm->stat0, *hi = norm->stat1;
+        if (norm->count == 0) {
+            for (k = 0; k < features; ++k) lo[k] = hi[k] = data[k];
+        }
+        for (s = 0; s < n; ++s) {
+            genann_real const *x = data + (size_t)s * features;
+            for (k = 0; k < features; ++k) {
+                if (x[k] < lo[k]) lo[k] = x[k];
+                if (x[k] > hi[k]) hi[k] = x[k];
+            }
+        }
+        norm->count += n;
+        return;
+    }
+
+    /* Mean and squared deviations of this chunk, two passes over it, then
+     * merged into the running totals (Chan et al.). Each pass walks rows in
+     * order with the feature loop innermost, so it vectorizes. */
+    double *mean = malloc(sizeof(double) * 2 * features);
+    if (!mean) return;
+    double *m2 = mean + features;
+
+    for (k = 0; k < features; ++k) mean[k] = m2[k] = 0;
+    for (s = 0; s < n; ++s) {
+        genann_real const *x = data + (size_t)s * features;
+        for (k = 0; k < features; ++k) mean[k] += x[k];
+    }
+    for (k = 0; k < features; ++k) mean[k] /= n;
+    for (s = 0; s < n; ++s) {
+        genann_real const *x = data + (size_t)s * features;
+        for (k = 0; k < features; ++k) {
+            const double d = x[k] - mean[k];
+            m2[k] += d * d;
+        }
+    }
+
+    const double total = norm->count + n;
+    for (k = 0; k < features; ++k) {
+        const double delta = mean[k] - norm->stat0[k];
+        norm->stat0[k] += delta * n / total;
+        norm->stat1[k] += m2[k] + delta * delta * norm->count * n / total;
+    }
+    norm->count = total;
+
+    free(mean);
+}
+
+
+void genann_norm_finish(genann_norm *norm) {
+    int k;
+    for (k = 0; k < norm->features; ++k) {
+        double shift, spread;
+        if (norm->mode == GENANN_NORM_MINMAX) {
+            shift = norm->stat0[k];
+            spread = norm->stat1[k] - norm->stat0[k];
+        } else {
+            shift = norm->stat0[k];
+            spread = norm->count > 0 ? sqrt(norm->stat1[k] / norm->count) : 0;
+        }
+        norm->shift[k] = shift;
+        norm->scale[k] = spread > 0 ? 1 / spread : 1;
+    }
+}
+
+
+genann_norm *genann_norm_fit(genann_real const *data, int n, int features, int mode) {
+    genann_norm *norm = genann_norm_init(features, mode);
+    if (!norm) return 0;
+    genann_norm_add(norm, data, n);
+    genann_norm_finish(norm);
+    return norm;
+}
+
+
+void genann_norm_apply(genann_norm const *norm, genann_real *data, int n) {
+    const int features = norm->features;
+    genann_real const *shift = norm->shift, *scale = norm->scale;
+    int k, s;
+    for (s = 0; s < n; ++s) {
+        genann_real *x = data + (size_t)s * features;
+        for (k = 0; k < features; ++k) x[k] = (x[k] - shift[k]) * scale[k];
+    }
+}
+
+
+int genann_norm_fold(genann_norm const *norm, genann *ann) {
+    if (ann->inputs != norm->features) return -1;
+
+    /* For each first layer neuron with bias b and weights w:
+     * -b + sum w[k] * (x[k] - shift[k]) * scale[k]
+     *   = -(b + sum w[k] * scale[k] * shift[k]) + sum (w[k] * scale[k]) * x[k]. */
+    const int ins = ann->inputs;
+    genann_real *w = ann->weight + ann->weight_offset[1];
+    int j, k;
+    for (j = 0; j < ann->width[1]; ++j, w += ins + 1) {
+        double bias = w[0];
+        for (k = 0; k < ins; ++k) {
+            w[k + 1] *= norm->scale[k];
+            bias += (double)w[k + 1] * norm->shift[k];
+        }
+        w[0] = bias;
+    }
+
+    return 0;
+}
+
+
+void genann_norm_write(genann_norm const *norm, FILE *out) {
+    fprintf(out, "%d %d", norm->features, norm->mode);
+
+    int k;
+    for (k = 0; k < norm->features; ++k) {
+        fprintf(out, " %.20e %.20e", norm->shift[k], norm->scale[k]);
+    }
+}
+
+
+genann_norm *genann_norm_read(FILE *in) {
+    int features, mode;
+    if (fscanf(in, "%d %d", &features, &mode) != 2) return 0;
+
+    genann_norm *norm = genann_norm_init(features, mode);
+    if (!norm) return 0;
+
+    int k;
+    for (k = 0; k < features; ++k) {
+        if (fscanf(in, " %" GENANN_SCN " %" GENANN_SCN, norm->shift + k, norm->scale + k) != 2) {
+            genann_norm_free(norm);
+            return 0;
+        }
+    }
+
+    return norm;
+}
+
+
+void genann_norm_free(genann_norm *norm) {
+    /* Statistics and transform live in the same allocation. */
+    free(norm);
+}
@@ -0,0 +1,104 @@
+/*
+ * GENANN - Minimal C Artificial Neural Network
+ *
+ * Copyright (c) 2015, 2016 Lewis Van Winkle
+ *
+ * http://CodePlea.com
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgement in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ */
+
+
+
+#ifndef __GENANN_NORM_H__
+#define __GENANN_NORM_H__
+
+#include "genann.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Normalization modes. */
+#define GENANN_NORM_ZSCORE 0    /* (x - mean) / standard deviation */
+#define GENANN_NORM_MINMAX 1    /* (x - min) / (max - min), into [0, 1] */
+
+
+/* Per-feature affine transform x' = (x - shift) * scale, fitted to data. */
+typedef struct genann_norm {
+    int features, mode;
+
+    /* Observations seen by genann_norm_add. */
+    double count;
+
+    /* The transform, set by genann_norm_finish (features long each). */
+    genann_real *shift;
+    genann_real *scale;
+
+    /* Running statistics: mean and sum of squared deviations for
+     * GENANN_NORM_ZSCORE, min and max for GENANN_NORM_MINMAX. */
+    double *stat0;
+    double *stat1;
+
+} genann_norm;
+
+
+/* Creates an empty normalizer for rows of features values. */
+genann_norm *genann_norm_init(int features, int mode);
+
+/* Adds n rows (row-major) to the statistics. Call once per chunk to fit a
+ * stream in a single pass. */
+void genann_norm_add(genann_norm *norm, genann_real const *data, int n);
+
+/* Computes shift and scale from the statistics. Features with no spread
+ * are only shifted. */
+void genann_norm_finish(genann_norm *norm);
+
+/* Creates a normalizer fitted to n rows: init, add and finish in one call. */
+genann_norm *genann_norm_fit(genann_real const *data, int n, int features, int mode);
+
+/* Transforms n rows in place. */
+void genann_norm_apply(genann_norm const *norm, genann_real *data, int n);
+
+/* Folds the transform into the weights of ann's first layer, so that ann
+ * gives the same outputs on raw inputs as it did on normalized ones, and
+ * full precision inference needs no separate normalization. Quantized
+ * inference still needs the norm: folded weight columns differ in scale as
+ * much as the raw features do, so pass it to genann_q8_quantize, and keep it
+ * with genann_norm_write alongside the ann.
+ * Returns 0 on success, -1 if ann doesn't take norm's features as inputs. */
+int genann_norm_fold(genann_norm const *norm, genann *ann);
+
+/* Saves the transform (not the statistics) as text. */
+void genann_norm_write(genann_norm const *norm, FILE *out);
+
+/* Loads a transform saved by genann_norm_write. Its statistics are empty,
+ * so it can be applied and folded but not refitted with genann_norm_add.
+ * Returns 0 on a read error or a malformed file. */
+genann_norm *genann_norm_read(FILE *in);
+
+/* Frees the memory used by a normalizer. */
+void genann_norm_free(genann_norm *norm);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*__GENANN_NORM_H__*/
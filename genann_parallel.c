@@ -0,0 +1,188 @@
+/*
+ * GENANN - Minimal C Artificial Neural Network
+ *
+ * Copyright (c) 2015, 2016 Lewis Van Winkle
+ *
+ * http://CodePlea.com
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgement in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ */
+
+
+#include "genann_parallel.h"
+#include "genann_simd.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+
+#define CACHE_LINE 64
+
+/* Per thread buffers start on a cache line and are rounded up to whole ones,
+ * so threads never share one. */
+#define LINE_REALS (CACHE_LINE / sizeof(genann_real))
+#define PAD(count) (((count) + LINE_REALS - 1) / LINE_REALS * LINE_REALS)
+
+
+typedef struct parallel_job {
+    genann const *ann;
+    genann_real const *inputs;
+    genann_real const *desired_outputs;
+    double learning_rate;
+
+    /* Rows [first, first + count) of the current mini-batch or epoch. */
+    int first, count;
+
+    /* Per thread buffers, stride genann_reals apart. */
+    genann_real *scratch;
+    size_t stride;
+} parallel_job;
+
+
+/* Splits count items evenly over threads; thread index gets [*lo, *hi). */
+static void share(int count, int index, int threads, int *lo, int *hi) {
+    *lo = (int)((long long)count * index / threads);
+    *hi = (int)((long long)count * (index + 1) / threads);
+}
+
+
+/* Phase one of a synchronous step: gradient of this thread's shard. */
+static void sync_gradient(void *ctx, int index, int threads) {
+    parallel_job const *job = ctx;
+    genann const *ann = job->ann;
+    genann_real *grad = job->scratch + job->stride * index;
+
+    int lo, hi;
+    share(job->count, index, threads, &lo, &hi);
+
+    if (hi == lo) {
+        memset(grad, 0, sizeof(genann_real) * ann->total_weights);
+        return;
+    }
+
+    const int first = job->first + lo;
+    genann_gradient(ann, job->inputs + (size_t)first * ann->inputs,
+            job->desired_outputs + (size_t)first * ann->outputs,
+            hi - lo, grad, grad + PAD(ann->total_weights));
+}
+
+
+/* Phase two: each thread sums every shard's gradient over its own slice of
+ * the weights, in shard order, and applies it. */
+static void sync_update(void *ctx, int index, int threads) {
+    parallel_job const *job = ctx;
+    genann const *ann = job->ann;
+
+    int lo, hi, t;
+    share(ann->total_weights, index, threads, &lo, &hi);
+    if (hi == lo) return;
+
+    /* Plain SGD adds each shard straight into the weights. */
+    if (!ann->moment) {
+        for (t = 0; t < threads; ++t) {
+            genann_real const *grad = job->scratch + job->stride * t;
+            genann_kern.axpy(job->learning_rate, grad + lo, ann->weight + lo, hi - lo);
+        }
+        return;
+    }
+
+    /* Other optimizers need the whole gradient: sum the shards into the first. */
+    genann_real *sum = job->scratch;
+    for (t = 1; t < threads; ++t) {
+        genann_kern.axpy(1, job->scratch + job->stride * t + lo, sum + lo, hi - lo);
+    }
+    genann_update(ann, sum, job->learning_rate, lo, hi - lo);
+}
+
+
+static void hogwild_epoch(void *ctx, int index, int threads) {
+    parallel_job const *job = ctx;
+    genann const *ann = job->ann;
+    genann_real *scratch = job->scratch + job->stride * index;
+
+    int lo, hi, i;
+    share(job->count, index, threads, &lo, &hi);
+
+    for (i = lo; i < hi; ++i) {
+        genann_train_r(ann, job->inputs + (size_t)i * ann->inputs,
+                job->desired_outputs + (size_t)i * ann->outputs,
+                job->learning_rate, scratch);
+    }
+}
+
+
+int genann_train_parallel(genann const *ann, genann_threads *threads,
+        genann_real const *inputs, genann_real const *desired_outputs, int n,
+        int batch, double learning_rate, int mode) {
+    const int count = genann_threads_count(threads);
+
+    parallel_job job;
+    job.ann = ann;
+    job.inputs = inputs;
+    job.desired_outputs = desired_outputs;
+    job.learning_rate = learning_rate;
+
+    if (mode == GENANN_PARALLEL_HOGWILD) {
+        job.stride = PAD(2 * ann->total_neurons - ann->inputs);
+    } else {
+        if (batch < 1) batch = 1;
+        const int shard = (batch + count - 1) / count;
+        job.stride = PAD(ann->total_weights) + PAD(genann_gradient_work(ann, shard));
+    }
+
+    void *block = malloc(sizeof(genann_real) * job.stride * count + CACHE_LINE);
+    if (!block) return -1;
+    job.scratch = (genann_real*)(((uintptr_t)block + CACHE_LINE - 1) & ~(uintptr_t)(CACHE_LINE - 1));
+
+    if (mode == GENANN_PARALLEL_HOGWILD) {
+        job.first = 0;
+        job.count = n;
+        genann_threads_run(threads, hogwild_epoch, &job);
+    } else {
+        int b;
+        for (b = 0; b < n; b += batch) {
+            job.first = b;
+            job.count = (n - b < batch) ? n - b : batch;
+            genann_threads_run(threads, sync_gradient, &job);
+            ++*ann->step;
+            genann_threads_run(threads, sync_update, &job);
+        }
+    }
+
+    free(block);
+    return 0;
+}
+
+
+long genann_train_stream(genann const *ann, genann_threads *threads, genann_csv_stream *stream,
+        int batch, double learning_rate, int mode) {
+    if (ann->outputs != 1 || ann->inputs != genann_csv_stream_features(stream)) return -1;
+
+    genann_real *data, *labels;
+    long total = 0;
+    int rows;
+
+    /* The reader parses the next chunk while this one trains. */
+    while ((rows = genann_csv_stream_next(stream, &data, &labels)) > 0) {
+        if (genann_train_parallel(ann, threads, data, labels, rows, batch, learning_rate, mode) != 0) return -1;
+        total += rows;
+    }
+
+    return rows < 0 ? -1 : total;
+}
@@ -0,0 +1,74 @@
+/*
+ * GENANN - Minimal C Artificial Neural Network
+ *
+ * Copyright (c) 2015, 2016 Lewis Van Winkle
+ *
+ * http://CodePlea.com
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgement in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ */
+
+
+#ifndef __GENANN_PARALLEL_H__
+#define __GENANN_PARALLEL_H__
+
+#include "genann.h"
+#include "genann_csv.h"
+#include "genann_threads.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Synchronous data parallel training. Each mini-batch is split into one shard
+ * per thread; every thread computes the gradient of its shard, the shards are
+ * summed with a reduce-scatter (each thread owns a slice of the weights) and
+ * applied once. The result depends only on the data order and the thread
+ * count, so it is reproducible for a fixed seed. With one thread it matches
+ * genann_train_batch exactly. */
+#define GENANN_PARALLEL_SYNC 0
+
+/* Asynchronous Hogwild-style training. Each thread runs per-observation
+ * genann_train_r updates on its own slice of the data against the shared
+ * weights, without locks. Fastest when updates rarely touch the same weights;
+ * results are not reproducible between runs. */
+#define GENANN_PARALLEL_HOGWILD 1
+
+
+/* Trains one epoch over n observations (row-major) on threads.
+ * batch is the mini-batch size for GENANN_PARALLEL_SYNC and is ignored by
+ * GENANN_PARALLEL_HOGWILD. Returns 0 on success, -1 if scratch memory could
+ * not be allocated. */
+int genann_train_parallel(genann const *ann, genann_threads *threads,
+        genann_real const *inputs, genann_real const *desired_outputs, int n,
+        int batch, double learning_rate, int mode);
+
+/* Trains one pass over a stream, chunk by chunk, with genann_train_parallel.
+ * The stream's label is the ann's only output. Returns the number of
+ * observations trained on, or -1 on a read error, an allocation failure or
+ * a shape mismatch. Time spent waiting on I/O is genann_csv_stream_stall. */
+long genann_train_stream(genann const *ann, genann_threads *threads, genann_csv_stream *stream,
+        int batch, double learning_rate, int mode);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*__GENANN_PARALLEL_H__*/
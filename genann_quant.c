@@ -0,0 +1,243 @@
+/*
+ * GENANN - Minimal C Artificial Neural Network
+ *
+ * Copyright (c) 2015, 2016 Lewis Van Winkle
+ *
+ * http://CodePlea.com
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgement in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ */
+
+
+#include "genann_quant.h"
+#include "genann_simd.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+
+/* Quantizes n values symmetrically into [-127, 127] and returns the scale
+ * that maps them back, so x[k] ~= q[k] * scale. */
+static genann_real quantize_row(genann_real const *x, int n, signed char *q) {
+    genann_real max = 0;
+    int k;
+    for (k = 0; k < n; ++k) {
+        const genann_real a = x[k] < 0 ? -x[k] : x[k];
+        if (a > max) max = a;
+    }
+
+    if (max == 0) {
+        memset(q, 0, n);
+        return 1;
+    }
+
+    const genann_real inv = 127 / max;
+    for (k = 0; k < n; ++k) {
+        const genann_real v = x[k] * inv;
+        q[k] = (signed char)(v < 0 ? v - 0.5 : v + 0.5);
+    }
+
+    return max / 127;
+}
+
+
+/* Widest layer that is some layer's input. */
+static int widest_input(int const *width, int hidden_layers) {
+    int widest = 0, h;
+    for (h = 0; h <= hidden_layers; ++h) {
+        if (width[h] > widest) widest = width[h];
+    }
+    return widest;
+}
+
+
+/* Work space of genann_q8_run_r for these sizes, in genann_real values. */
+static size_t run_work(int total_neurons, int widest) {
+    return total_neurons + (widest + sizeof(genann_real) - 1) / sizeof(genann_real);
+}
+
+
+genann_q8 *genann_q8_quantize(genann const *ann, genann_norm const *norm) {
+    if (norm && norm->features != ann->inputs) return 0;
+
+    const int neurons = ann->total_neurons - ann->inputs;
+    const int total_weights = ann->total_weights - neurons;
+
+    const int layers = ann->hidden_layers + 2;
+    const int widest = widest_input(ann->width, ann->hidden_layers);
+    const int transforms = 2 * ann->inputs;
+    const size_t work = run_work(ann->total_neurons, widest);
+
+    /* Width table, then full precision arrays so they stay aligned, work space
+     * (ending in qinput) and weights after. */
+    const size_t tables = (sizeof(genann_q8) + sizeof(int) * layers + 15) / 16 * 16;
+    const size_t size = tables + sizeof(genann_real) * (2 * neurons + transforms + work) + total_weights;
+    genann_q8 *ret = malloc(size);
+    if (!ret) return 0;
+
+    ret->inputs = ann->inputs;
+    ret->hidden_layers = ann->hidden_layers;
+    ret->hidden = ann->hidden;
+    ret->outputs = ann->outputs;
+    ret->activation_hidden = ann->activation_hidden;
+    ret->activation_output = ann->activation_output;
+    ret->total_weights = total_weights;
+    ret->total_neurons = ann->total_neurons;
+
+    /* Set pointers. */
+    ret->width = (int*)((char*)ret + sizeof(genann_q8));
+    memcpy(ret->width, ann->width, sizeof(int) * layers);
+    ret->bias = (genann_real*)((char*)ret + tables);
+    ret->scale = ret->bias + neurons;
+    ret->input_shift = ret->scale + neurons;
+    ret->input_scale = ret->input_shift + ann->inputs;
+    ret->quantize_inputs = norm != 0;
+    ret->output = ret->scale + neurons + transforms;
+    ret->qinput = (signed char*)(ret->output + ret->total_neurons);
+    ret->weight = (signed char*)(ret->output + work);
+
+    int j, k;
+    for (k = 0; k < ann->inputs; ++k) {
+        if (norm) {
+            /* A feature with no spread keeps scale 1 (see genann_norm_finish). */
+            ret->input_shift[k] = norm->shift[k];
+            ret->input_scale[k] = norm->scale[k] != 0 ? norm->scale[k] : 1;
+        } else {
+            /* Scaling input k up by its largest weight scales that weight
+             * column down to [-1, 1], so no column is lost to another's range. */
+            genann_real max = 0;
+            for (j = 0; j < ann->width[1]; ++j) {
+                const genann_real a = ann->weight[j * (ann->inputs + 1) + 1 + k];
+                if ((a < 0 ? -a : a) > max) max = a < 0 ? -a : a;
+            }
+            ret->input_shift[k] = 0;
+            ret->input_scale[k] = max != 0 ? max : 1;
+        }
+    }
+
+    /* First layer weights in terms of the transformed inputs, one row at a time. */
+    genann_real *row = malloc(sizeof(genann_real) * ann->inputs);
+    if (!row) {
+        free(ret);
+        return 0;
+    }
+
+    genann_real const *w = ann->weight;
+    signed char *qw = ret->weight;
+    int n = 0, h;
+
+    for (h = 0; h <= ann->hidden_layers; ++h) {
+        const int ins = ann->width[h];
+        const int outs = ann->width[h+1];
+
+        for (j = 0; j < outs; ++j) {
+            ret->bias[n] = *w;
+            if (h == 0) {
+                /* w x = (w / scale) ((x - shift) scale) + w shift; the constant
+                 * goes into the bias, which enters the sum negated. */
+                double shifted = *w;
+                for (k = 0; k < ins; ++k) {
+                    row[k] = w[1+k] / ret->input_scale[k];
+                    shifted -= (double)w[1+k] * ret->input_shift[k];
+                }
+                ret->bias[n] = (genann_real)shifted;
+                ret->scale[n] = quantize_row(row, ins, qw);
+            } else {
+                ret->scale[n] = quantize_row(w + 1, ins, qw);
+            }
+            w += ins + 1;
+            qw += ins;
+            ++n;
+        }
+    }
+
+    free(row);
+
+    assert(w - ann->weight == ann->total_weights);
+    assert(qw - ret->weight == ret->total_weights);
+
+    return ret;
+}
+
+
+void genann_q8_free(genann_q8 *q) {
+    /* All buffers live in the same allocation. */
+    free(q);
+}
+
+
+genann_real const *genann_q8_run(genann_q8 *q, genann_real const *inputs) {
+    return genann_q8_run_r(q, inputs, q->output);
+}
+
+
+size_t genann_q8_run_work(genann_q8 const *q) {
+    return run_work(q->total_neurons, widest_input(q->width, q->hidden_layers));
+}
+
+
+genann_real const *genann_q8_run_r(genann_q8 const *q, genann_real const *inputs, genann_real *work) {
+    signed char const *w = q->weight;
+    signed char *qinput = (signed char*)(work + q->total_neurons);
+    genann_real *o = work + q->inputs;
+    genann_real *i = work;
+
+    int n = 0, h, j, k;
+
+    for (k = 0; k < q->inputs; ++k) {
+        i[k] = (inputs[k] - q->input_shift[k]) * q->input_scale[k];
+    }
+
+    for (h = 0; h <= q->hidden_layers; ++h) {
+        const int ins = q->width[h];
+        const int outs = q->width[h+1];
+        const int act = (h == q->hidden_layers) ? q->activation_output : q->activation_hidden;
+
+        if (h == 0 && !q->quantize_inputs) {
+            /* No common input range: 8-bit weights against full precision inputs. */
+            for (j = 0; j < outs; ++j) {
+                genann_real acc = 0;
+                for (k = 0; k < ins; ++k) acc += w[k] * i[k];
+                *o++ = q->bias[n] * -1 + acc * q->scale[n];
+                w += ins;
+                ++n;
+            }
+        } else {
+            /* Quantize this layer's input once; every neuron in the layer shares it. */
+            const genann_real input_scale = quantize_row(i, ins, qinput);
+
+            for (j = 0; j < outs; ++j) {
+                const int acc = genann_kern.dot_s8(w, qinput, ins);
+                *o++ = q->bias[n] * -1 + acc * (q->scale[n] * input_scale);
+                w += ins;
+                ++n;
+            }
+        }
+
+        /* Back to full precision only here, at the layer boundary. */
+        genann_act_layer(act, o - outs, outs);
+
+        i += ins;
+    }
+
+    assert(w - q->weight == q->total_weights);
+    assert(o - work == q->total_neurons);
+
+    return work + q->total_neurons - q->outputs;
+}
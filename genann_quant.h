@@ -0,0 +1,118 @@
+/*
+ * GENANN - Minimal C Artificial Neural Network
+ *
+ * Copyright (c) 2015, 2016 Lewis Van Winkle
+ *
+ * http://CodePlea.com
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgement in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ */
+
+
+#ifndef __GENANN_QUANT_H__
+#define __GENANN_QUANT_H__
+
+#include "genann.h"
+#include "genann_norm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* An inference-only copy of a trained ann with 8-bit weights.
+ * Each neuron keeps its own weight scale and a full precision bias. Layer
+ * inputs are quantized to 8 bits on the fly with one scale per layer,
+ * products are accumulated in 32 bits and the activation function runs once
+ * per neuron. Raw features rarely share a range, so the first layer scales
+ * each input feature on its own and folds that scale into its weights. */
+typedef struct genann_q8 {
+    /* How many inputs, outputs, and hidden neurons. hidden is the widest hidden layer. */
+    int inputs, hidden_layers, hidden, outputs;
+
+    /* Neurons in each layer, inputs to outputs (hidden_layers + 2 long). */
+    int *width;
+
+    /* Activation functions (GENANN_ACT_*), copied from the source ann. */
+    int activation_hidden;
+    int activation_output;
+
+    /* Number of 8-bit weights (bias weights are not included). */
+    int total_weights;
+
+    /* Total number of neurons + inputs and size of output buffer. */
+    int total_neurons;
+
+    /* Bias weight of each hidden and output neuron (total_neurons - inputs long). */
+    genann_real *bias;
+
+    /* Weight scale of each hidden and output neuron (total_neurons - inputs long). */
+    genann_real *scale;
+
+    /* Per-input transform (x - shift) * scale applied before the first layer,
+     * folded back into that layer's weights and biases (inputs long each).
+     * From the norm given to genann_q8_quantize, or without one shift 0 and
+     * scale the largest first layer weight of that input. */
+    genann_real *input_shift;
+    genann_real *input_scale;
+
+    /* 1 if the transformed first layer inputs are quantized like every other
+     * layer's (with a norm), 0 if they stay in full precision. */
+    int quantize_inputs;
+
+    /* Work space of genann_q8_run: the input array and output of each neuron
+     * (total_neurons long), followed by qinput. */
+    genann_real *output;
+
+    /* Quantized copy of the current layer's input (widest layer long). */
+    signed char *qinput;
+
+    /* All quantized weights, one row per neuron (total_weights long). */
+    signed char *weight;
+
+} genann_q8;
+
+
+/* Creates an 8-bit copy of a trained ann. norm, if not 0, is the
+ * normalization fitted to its training inputs (folded into ann or not, see
+ * genann_norm_fold); it brings every input to a common range, so the first
+ * layer's inputs can be quantized too. Without it the first layer's weights
+ * are scaled per input and its inputs stay in full precision. Returns 0 if
+ * norm doesn't have ann's inputs as features. */
+genann_q8 *genann_q8_quantize(genann const *ann, genann_norm const *norm);
+
+/* Frees the memory used by a quantized ann. */
+void genann_q8_free(genann_q8 *q);
+
+/* Runs the feedforward algorithm on the quantized ann, in q's own work space. */
+genann_real const *genann_q8_run(genann_q8 *q, genann_real const *inputs);
+
+/* Number of genann_real values of work space genann_q8_run_r needs. */
+size_t genann_q8_run_work(genann_q8 const *q);
+
+/* Reentrant version of genann_q8_run. work must hold genann_q8_run_work(q)
+ * values, and q is only read, so threads can share one q as long as each
+ * passes its own work. Returns a pointer to the outputs in work. */
+genann_real const *genann_q8_run_r(genann_q8 const *q, genann_real const *inputs, genann_real *work);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*__GENANN_QUANT_H__*/
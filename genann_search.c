@@ -0,0 +1,345 @@
+/*
+ * GENANN - Minimal C Artificial Neural Network
+ *
+ * Copyright (c) 2015, 2016 Lewis Van Winkle
+ *
+ * http://CodePlea.com
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgement in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ */
+
+
+#include "genann_search.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef __GNUC__
+#include <pthread.h>
+#endif
+
+
+genann_config *genann_space_grid(genann_space const *space, int *count) {
+    if (space->hidden_layers_count < 1 || space->hidden_count < 1 || space->learning_rate_count < 1 ||
+            space->batch_count < 1 || space->optimizer_count < 1) return 0;
+
+    const long total = (long)space->hidden_layers_count * space->hidden_count * space->learning_rate_count *
+            space->batch_count * space->optimizer_count;
+    if (total > 1 << 24) return 0;
+
+    genann_config *ret = malloc(sizeof(genann_config) * total);
+    if (!ret) return 0;
+
+    /* Mixed radix counter, the last list varying fastest. */
+    long i;
+    for (i = 0; i < total; ++i) {
+        long r = i;
+        genann_config *c = ret + i;
+        c->optimizer = space->optimizer[r % space->optimizer_count]; r /= space->optimizer_count;
+        c->batch = space->batch[r % space->batch_count]; r /= space->batch_count;
+        c->learning_rate = space->learning_rate[r % space->learning_rate_count]; r /= space->learning_rate_count;
+        c->hidden = space->hidden[r % space->hidden_count]; r /= space->hidden_count;
+        c->hidden_layers = space->hidden_layers[r];
+    }
+
+    *count = (int)total;
+    return ret;
+}
+
+
+/* xorshift32; state must not be 0. */
+static unsigned next_random(unsigned *state) {
+    unsigned x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+
+genann_config *genann_space_sample(genann_space const *space, int count, unsigned seed) {
+    if (count < 1 || space->hidden_layers_count < 1 || space->hidden_count < 1 || space->learning_rate_count < 1 ||
+            space->batch_count < 1 || space->optimizer_count < 1) return 0;
+
+    genann_config *ret = malloc(sizeof(genann_config) * count);
+    if (!ret) return 0;
+
+    double lo = space->learning_rate[0], hi = lo;
+    int i;
+    for (i = 1; i < space->learning_rate_count; ++i) {
+        if (space->learning_rate[i] < lo) lo = space->learning_rate[i];
+        if (space->learning_rate[i] > hi) hi = space->learning_rate[i];
+    }
+
+    unsigned state = seed ? seed : 1;
+    for (i = 0; i < count; ++i) {
+        genann_config *c = ret + i;
+        c->hidden_layers = space->hidden_layers[next_random(&state) % space->hidden_layers_count];
+        c->hidden = space->hidden[next_random(&state) % space->hidden_count];
+        c->batch = space->batch[next_random(&state) % space->batch_count];
+        c->optimizer = space->optimizer[next_random(&state) % space->optimizer_count];
+
+        const double u = next_random(&state) / 4294967296.0;
+        c->learning_rate = lo > 0 ? lo * pow(hi / lo, u) : lo + (hi - lo) * u;
+    }
+
+    return ret;
+}
+
+
+typedef struct search_job {
+    genann_real const *train_inputs, *train_outputs;
+    genann_real const *valid_inputs, *valid_outputs;
+    int n_train, n_valid;
+
+    /* Candidates still in the race, and the epoch count they train up to. */
+    genann_candidate **live;
+    int live_count, target;
+
+    /* Next live candidate to hand out. */
+    int next;
+    int failed;
+
+#ifndef __GNUC__
+    /* Guards next and failed where there are no atomic builtins. */
+    pthread_mutex_t lock;
+#endif
+} search_job;
+
+
+static void run(genann_threads *threads, genann_task task, void *ctx) {
+    if (threads) genann_threads_run(threads, task, ctx);
+    else task(ctx, 0, 1);
+}
+
+
+/* Returns the index of the next live candidate and moves past it. */
+static int take_next(search_job *job) {
+#ifdef __GNUC__
+    return __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+#else
+    pthread_mutex_lock(&job->lock);
+    const int i = job->next++;
+    pthread_mutex_unlock(&job->lock);
+    return i;
+#endif
+}
+
+
+static void set_failed(search_job *job) {
+#ifdef __GNUC__
+    __atomic_store_n(&job->failed, 1, __ATOMIC_RELAXED);
+#else
+    pthread_mutex_lock(&job->lock);
+    job->failed = 1;
+    pthread_mutex_unlock(&job->lock);
+#endif
+}
+
+
+/* Each thread takes the next untrained candidate until none are left, so
+ * cheap and expensive configs balance out. A thread's batch work space only
+ * grows, to the largest candidate it meets, so it is allocated a few times
+ * per rung rather than once per batch. */
+static void train_rung(void *ctx, int index, int threads) {
+    search_job *job = ctx;
+    (void)index;
+    (void)threads;
+
+    genann_real *work = 0;
+    size_t capacity = 0;
+
+    int i;
+    while ((i = take_next(job)) < job->live_count) {
+        genann_candidate *c = job->live[i];
+        genann const *ann = c->ann;
+        int batch = c->config.batch > 0 ? c->config.batch : 1;
+        if (batch > job->n_train) batch = job->n_train;
+
+        const size_t need = genann_train_batch_work(ann, batch);
+        if (need > capacity) {
+            free(work);
+            work = malloc(sizeof(genann_real) * need);
+            capacity = work ? need : 0;
+            if (!work) {
+                set_failed(job);
+                return;
+            }
+        }
+
+        for (; c->epochs < job->target; ++c->epochs) {
+            int b;
+            for (b = 0; b < job->n_train; b += batch) {
+                const int m = job->n_train - b < batch ? job->n_train - b : batch;
+                genann_train_batch_r(ann, job->train_inputs + (size_t)b * ann->inputs,
+                        job->train_outputs + (size_t)b * ann->outputs, m, c->config.learning_rate, work);
+            }
+        }
+
+        c->loss = genann_loss(ann, job->valid_inputs, job->valid_outputs, job->n_valid);
+        if (c->loss < 0) set_failed(job);
+
+        /* Diverged candidates rank last. */
+        if (c->loss != c->loss) c->loss = HUGE_VAL;
+    }
+
+    free(work);
+}
+
+
+static int compare_live(void const *a, void const *b) {
+    const double x = (*(genann_candidate * const *)a)->loss, y = (*(genann_candidate * const *)b)->loss;
+    return (x > y) - (x < y);
+}
+
+
+static int compare_rank(void const *a, void const *b) {
+    genann_candidate const *x = a, *y = b;
+    if (x->epochs != y->epochs) return y->epochs - x->epochs;
+    return (x->loss > y->loss) - (x->loss < y->loss);
+}
+
+
+genann_search *genann_search_run(int inputs, int outputs, genann_config const *configs, int count,
+        genann_real const *train_inputs, genann_real const *train_outputs, int n_train,
+        genann_real const *valid_inputs, genann_real const *valid_outputs, int n_valid,
+        genann_threads *threads, genann_search_options const *options) {
+    if (count < 1 || n_train < 1 || n_valid < 1) return 0;
+    if (options->min_epochs < 1 || options->max_epochs < options->min_epochs || options->eta < 2) return 0;
+
+    genann_search *ret = malloc(sizeof(genann_search) + sizeof(genann_candidate) * count);
+    genann_candidate **live = malloc(sizeof(genann_candidate*) * count);
+    int *width = malloc(sizeof(int) * 66);
+    if (!ret || !live || !width) {
+        free(ret);
+        free(live);
+        free(width);
+        return 0;
+    }
+
+    ret->count = count;
+    ret->candidate = (genann_candidate*)(ret + 1);
+    ret->rungs = 0;
+
+    /* Initialize every candidate here, in order, so the weights only depend
+     * on the seed. genann_randomize draws from GENANN_RANDOM, rand() unless
+     * overridden, so that is the generator seeded (see options->seed). */
+    srand(options->seed);
+    int i, l, failed = 0;
+    for (i = 0; i < count; ++i) {
+        genann_candidate *c = ret->candidate + i;
+        c->config = configs[i];
+        c->epochs = 0;
+        c->loss = HUGE_VAL;
+        c->ann = 0;
+        live[i] = c;
+
+        if (failed || c->config.hidden_layers < 0 || c->config.hidden_layers > 64) {
+            failed = 1;
+            continue;
+        }
+
+        width[0] = inputs;
+        for (l = 1; l <= c->config.hidden_layers; ++l) width[l] = c->config.hidden;
+        width[l] = outputs;
+
+        genann *ann = genann_init_layers(c->config.hidden_layers + 2, width);
+        if (ann) {
+            c->ann = genann_set_optimizer(ann, c->config.optimizer, options->momentum, 0.999);
+            if (!c->ann) genann_free(ann);
+        }
+        if (!c->ann) failed = 1;
+    }
+    free(width);
+
+    search_job job;
+    job.train_inputs = train_inputs;
+    job.train_outputs = train_outputs;
+    job.valid_inputs = valid_inputs;
+    job.valid_outputs = valid_outputs;
+    job.n_train = n_train;
+    job.n_valid = n_valid;
+    job.live = live;
+    job.live_count = count;
+    job.target = options->min_epochs;
+    job.failed = failed;
+#ifndef __GNUC__
+    pthread_mutex_init(&job.lock, 0);
+#endif
+
+    while (!job.failed) {
+        job.next = 0;
+        run(threads, train_rung, &job);
+        ++ret->rungs;
+
+        if (job.target >= options->max_epochs || job.live_count == 1) break;
+
+        /* Keep the best 1/eta and give them eta times the epochs. */
+        qsort(live, job.live_count, sizeof(genann_candidate*), compare_live);
+        job.live_count = (job.live_count + options->eta - 1) / options->eta;
+        job.target = job.target > options->max_epochs / options->eta ? options->max_epochs : job.target * options->eta;
+    }
+    free(live);
+#ifndef __GNUC__
+    pthread_mutex_destroy(&job.lock);
+#endif
+
+    if (job.failed) {
+        genann_search_free(ret);
+        return 0;
+    }
+
+    qsort(ret->candidate, count, sizeof(genann_candidate), compare_rank);
+    return ret;
+}
+
+
+int genann_search_ensemble(genann_search const *search, int k, genann_real const *inputs, int n, genann_real *outputs) {
+    if (k > search->count) k = search->count;
+    if (k < 1 || n < 1) return -1;
+
+    const size_t size = (size_t)n * search->candidate[0].ann->outputs;
+    genann_real *one = malloc(sizeof(genann_real) * size);
+    if (!one) return -1;
+
+    size_t j;
+    int i;
+    for (j = 0; j < size; ++j) outputs[j] = 0;
+
+    for (i = 0; i < k; ++i) {
+        if (genann_run_batch(search->candidate[i].ann, inputs, n, one) != 0) {
+            free(one);
+            return -1;
+        }
+        for (j = 0; j < size; ++j) outputs[j] += one[j];
+    }
+    for (j = 0; j < size; ++j) outputs[j] /= k;
+
+    free(one);
+    return 0;
+}
+
+
+void genann_search_free(genann_search *search) {
+    if (!search) return;
+
+    int i;
+    for (i = 0; i < search->count; ++i) genann_free(search->candidate[i].ann);
+    free(search);
+}
@@ -0,0 +1,131 @@
+/*
+ * GENANN - Minimal C Artificial Neural Network
+ *
+ * Copyright (c) 2015, 2016 Lewis Van Winkle
+ *
+ * http://CodePlea.com
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgement in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ */
+
+
+#ifndef __GENANN_SEARCH_H__
+#define __GENANN_SEARCH_H__
+
+#include "genann.h"
+#include "genann_threads.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* One point of a hyperparameter space. */
+typedef struct genann_config {
+    int hidden_layers, hidden;
+    double learning_rate;
+    int batch;
+
+    /* GENANN_OPT_*; see genann_set_optimizer. */
+    int optimizer;
+} genann_config;
+
+
+/* Values to try for each hyperparameter. Every list needs at least one entry. */
+typedef struct genann_space {
+    int const *hidden_layers; int hidden_layers_count;
+    int const *hidden; int hidden_count;
+    double const *learning_rate; int learning_rate_count;
+    int const *batch; int batch_count;
+    int const *optimizer; int optimizer_count;
+} genann_space;
+
+
+/* Returns every combination of space's values, and their number in *count.
+ * Free with free(). Returns 0 on failure. */
+genann_config *genann_space_grid(genann_space const *space, int *count);
+
+/* Returns count random configs from space. Each integer hyperparameter is
+ * picked from its list; the learning rate is drawn log-uniformly between the
+ * smallest and largest listed rates. Free with free(). Returns 0 on failure. */
+genann_config *genann_space_sample(genann_space const *space, int count, unsigned seed);
+
+
+/* How much to train. Candidates are trained to min_epochs, ranked by
+ * validation loss, and the best 1/eta of them go on for eta times as many
+ * epochs, until max_epochs or a single candidate is left (successive halving). */
+typedef struct genann_search_options {
+    int min_epochs, max_epochs, eta;
+
+    /* beta1 for genann_set_optimizer; beta2 is Adam's usual 0.999. */
+    double momentum;
+
+    /* Passed to srand() before the candidates are initialized, in order.
+     * This resets the caller's rand() sequence, and other threads must not
+     * call rand() during genann_search_run. Results only depend on the seed
+     * while GENANN_RANDOM is left as rand(). */
+    unsigned seed;
+} genann_search_options;
+
+
+typedef struct genann_candidate {
+    genann_config config;
+
+    /* The trained ann, as it was when the candidate stopped. */
+    genann *ann;
+
+    /* Epochs trained, and the validation loss (MSE) after the last one. */
+    int epochs;
+    double loss;
+} genann_candidate;
+
+
+/* Leaderboard of a search. */
+typedef struct genann_search {
+    /* Candidates, best first: those trained longest rank first, then by loss. */
+    int count;
+    genann_candidate *candidate;
+
+    /* Number of rounds of pruning. */
+    int rungs;
+} genann_search;
+
+
+/* Trains an ann for every config on n_train observations (row-major) and
+ * prunes them by loss on n_valid held-out observations. Candidates train
+ * concurrently, one per thread at a time (threads may be null); the data is
+ * only read and shared by all of them. Results are reproducible for a fixed
+ * seed, whatever the thread count. Returns 0 on failure. */
+genann_search *genann_search_run(int inputs, int outputs, genann_config const *configs, int count,
+        genann_real const *train_inputs, genann_real const *train_outputs, int n_train,
+        genann_real const *valid_inputs, genann_real const *valid_outputs, int n_valid,
+        genann_threads *threads, genann_search_options const *options);
+
+/* Runs n observations through the best k candidates and writes the mean of
+ * their outputs to outputs (n rows). Returns 0 on success, -1 on failure. */
+int genann_search_ensemble(genann_search const *search, int k, genann_real const *inputs, int n, genann_real *outputs);
+
+/* Frees a leaderboard and its anns. */
+void genann_search_free(genann_search *search);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*__GENANN_SEARCH_H__*/
@@ -0,0 +1,710 @@
+/*
+ * GENANN - Minimal C Artificial Neural Network
+ *
+ * Copyright (c) 2015, 2016 Lewis Van Winkle
+ *
+ * http://CodePlea.com
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgement in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ */
+
+#include "genann_simd.h"
+
+#include <math.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GENANN_SIMD_X86
+#include <immintrin.h>
+#endif
+
+
+/* Reference kernels. These define the results the vector versions must match. */
+
+static genann_real dot_scalar(genann_real const *a, genann_real const *b, int n) {
+    genann_real sum = 0;
+    int k;
+    for (k = 0; k < n; ++k) {
+        sum += a[k] * b[k];
+    }
+    return sum;
+}
+
+
+static void dot4_scalar(genann_real const *w0, genann_real const *w1, genann_real const *w2, genann_real const *w3,
+        genann_real const *x, int n, genann_real *out) {
+    genann_real s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    int k;
+    for (k = 0; k < n; ++k) {
+        s0 += w0[k] * x[k];
+        s1 += w1[k] * x[k];
+        s2 += w2[k] * x[k];
+        s3 += w3[k] * x[k];
+    }
+    out[0] = s0; out[1] = s1; out[2] = s2; out[3] = s3;
+}
+
+
+static void axpy_scalar(genann_real alpha, genann_real const *x, genann_real *y, int n) {
+    int k;
+    for (k = 0; k < n; ++k) {
+        y[k] += alpha * x[k];
+    }
+}
+
+
+static int dot_s8_scalar(signed char const *a, signed char const *b, int n) {
+    int sum = 0;
+    int k;
+    for (k = 0; k < n; ++k) {
+        sum += a[k] * b[k];
+    }
+    return sum;
+}
+
+
+static void sigmoid_scalar(genann_real *x, int n) {
+    int k;
+    for (k = 0; k < n; ++k) {
+        x[k] = genann_act_sigmoid(x[k]);
+    }
+}
+
+
+static void momentum_scalar(genann_real *w, genann_real *v, genann_real const *g,
+        genann_real mu, genann_real rate, int nesterov, int n) {
+    int k;
+    for (k = 0; k < n; ++k) {
+        const genann_real step = rate * g[k];
+        v[k] = mu * v[k] + step;
+        w[k] += nesterov ? mu * v[k] + step : v[k];
+    }
+}
+
+
+static void adam_scalar(genann_real *w, genann_real *m, genann_real *v, genann_real const *g,
+        genann_real b1, genann_real b2, genann_real rate, genann_real eps, int n) {
+    int k;
+    for (k = 0; k < n; ++k) {
+        m[k] = b1 * m[k] + (1 - b1) * g[k];
+        v[k] = b2 * v[k] + (1 - b2) * g[k] * g[k];
+        w[k] += rate * m[k] / (sqrt(v[k]) + eps);
+    }
+}
+
+
+#ifdef GENANN_SIMD_X86
+
+/* The vector kernels below are written once against these names, which map
+ * to the packed double or packed single intrinsics depending on genann_real. */
+#ifdef GENANN_FLOAT
+#define V128 __m128
+#define V128_LANES 4
+#define v128_zero _mm_setzero_ps
+#define v128_load _mm_loadu_ps
+#define v128_store _mm_storeu_ps
+#define v128_set1 _mm_set1_ps
+#define v128_add _mm_add_ps
+#define v128_mul _mm_mul_ps
+#define v128_sub _mm_sub_ps
+#define v128_div _mm_div_ps
+#define v128_sqrt _mm_sqrt_ps
+#define V256 __m256
+#define V256_LANES 8
+#define v256_zero _mm256_setzero_ps
+#define v256_load _mm256_loadu_ps
+#define v256_store _mm256_storeu_ps
+#define v256_set1 _mm256_set1_ps
+#define v256_add _mm256_add_ps
+#define v256_fmadd _mm256_fmadd_ps
+#define v256_fnmadd _mm256_fnmadd_ps
+#define v256_sub _mm256_sub_ps
+#define v256_mul _mm256_mul_ps
+#define v256_div _mm256_div_ps
+#define v256_sqrt _mm256_sqrt_ps
+#define v256_min _mm256_min_ps
+#define v256_max _mm256_max_ps
+#define v256_round _mm256_round_ps
+#define v256_cmp _mm256_cmp_ps
+#define v256_blendv _mm256_blendv_ps
+#define V512 __m512
+#define V512_LANES 16
+#define V512_MASK __mmask16
+#define v512_zero _mm512_setzero_ps
+#define v512_load _mm512_loadu_ps
+#define v512_maskz_load _mm512_maskz_loadu_ps
+#define v512_mask_store _mm512_mask_storeu_ps
+#define v512_set1 _mm512_set1_ps
+#define v512_add _mm512_add_ps
+#define v512_fmadd _mm512_fmadd_ps
+#define v512_hsum _mm512_reduce_add_ps
+#define v512_fnmadd _mm512_fnmadd_ps
+#define v512_sub _mm512_sub_ps
+#define v512_mul _mm512_mul_ps
+#define v512_div _mm512_div_ps
+#define v512_sqrt _mm512_sqrt_ps
+#define v512_min _mm512_min_ps
+#define v512_max _mm512_max_ps
+#define v512_roundscale _mm512_roundscale_ps
+#define v512_scalef _mm512_scalef_ps
+#define v512_cmp_mask _mm512_cmp_ps_mask
+#define v512_mask_blend _mm512_mask_blend_ps
+#else
+#define V128 __m128d
+#define V128_LANES 2
+#define v128_zero _mm_setzero_pd
+#define v128_load _mm_loadu_pd
+#define v128_store _mm_storeu_pd
+#define v128_set1 _mm_set1_pd
+#define v128_add _mm_add_pd
+#define v128_mul _mm_mul_pd
+#define v128_sub _mm_sub_pd
+#define v128_div _mm_div_pd
+#define v128_sqrt _mm_sqrt_pd
+#define V256 __m256d
+#define V256_LANES 4
+#define v256_zero _mm256_setzero_pd
+#define v256_load _mm256_loadu_pd
+#define v256_store _mm256_storeu_pd
+#define v256_set1 _mm256_set1_pd
+#define v256_add _mm256_add_pd
+#define v256_fmadd _mm256_fmadd_pd
+#define v256_fnmadd _mm256_fnmadd_pd
+#define v256_sub _mm256_sub_pd
+#define v256_mul _mm256_mul_pd
+#define v256_div _mm256_div_pd
+#define v256_sqrt _mm256_sqrt_pd
+#define v256_min _mm256_min_pd
+#define v256_max _mm256_max_pd
+#define v256_round _mm256_round_pd
+#define v256_cmp _mm256_cmp_pd
+#define v256_blendv _mm256_blendv_pd
+#define V512 __m512d
+#define V512_LANES 8
+#define V512_MASK __mmask8
+#define v512_zero _mm512_setzero_pd
+#define v512_load _mm512_loadu_pd
+#define v512_maskz_load _mm512_maskz_loadu_pd
+#define v512_mask_store _mm512_mask_storeu_pd
+#define v512_set1 _mm512_set1_pd
+#define v512_add _mm512_add_pd
+#define v512_fmadd _mm512_fmadd_pd
+#define v512_hsum _mm512_reduce_add_pd
+#define v512_fnmadd _mm512_fnmadd_pd
+#define v512_sub _mm512_sub_pd
+#define v512_mul _mm512_mul_pd
+#define v512_div _mm512_div_pd
+#define v512_sqrt _mm512_sqrt_pd
+#define v512_min _mm512_min_pd
+#define v512_max _mm512_max_pd
+#define v512_roundscale _mm512_roundscale_pd
+#define v512_scalef _mm512_scalef_pd
+#define v512_cmp_mask _mm512_cmp_pd_mask
+#define v512_mask_blend _mm512_mask_blend_pd
+#endif
+
+
+/* exp(x) = 2^n * exp(r) with n = round(x / ln 2) and |r| <= ln(2) / 2.
+ * exp(r) is a Taylor polynomial, long enough to be exact to the last bit or
+ * two, and ln 2 is split in two parts so r keeps its low bits. */
+#ifdef GENANN_FLOAT
+#define EXP_DEGREE 7
+static const float exp_coef[EXP_DEGREE + 1] = {
+    0.000198412698f, 0.00138888889f, 0.00833333333f, 0.0416666667f, 0.166666667f, 0.5f, 1, 1
+};
+#define LN2_HI 0.693359375f
+#define LN2_LO -2.12194440e-4f
+#define LOG2E 1.44269504f
+#else
+#define EXP_DEGREE 12
+static const double exp_coef[EXP_DEGREE + 1] = {
+    2.08767569878681e-09, 2.505210838544172e-08, 2.7557319223985888e-07, 2.7557319223985893e-06,
+    2.4801587301587302e-05, 0.00019841269841269841, 0.0013888888888888889, 0.0083333333333333332,
+    0.041666666666666664, 0.16666666666666666, 0.5, 1, 1
+};
+#define LN2_HI 6.93145751953125e-1
+#define LN2_LO 1.42860682030941723212e-6
+#define LOG2E 1.4426950408889634
+#endif
+
+/* genann_act_sigmoid saturates outside this range; the vector kernels do the same. */
+#define SIGMOID_LIMIT 45
+
+
+/* SSE2, 128-bit registers. */
+
+__attribute__((target("sse2")))
+static genann_real v128_hsum(V128 v) {
+#ifdef GENANN_FLOAT
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    return _mm_cvtss_f32(_mm_add_ss(v, _mm_shuffle_ps(v, v, 1)));
+#else
+    return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+#endif
+}
+
+
+__attribute__((target("sse2")))
+static genann_real dot_sse2(genann_real const *a, genann_real const *b, int n) {
+    V128 s0 = v128_zero(), s1 = v128_zero();
+    int k = 0;
+    for (; k + 2 * V128_LANES <= n; k += 2 * V128_LANES) {
+        s0 = v128_add(s0, v128_mul(v128_load(a+k), v128_load(b+k)));
+        s1 = v128_add(s1, v128_mul(v128_load(a+k+V128_LANES), v128_load(b+k+V128_LANES)));
+    }
+    genann_real sum = v128_hsum(v128_add(s0, s1));
+    for (; k < n; ++k) sum += a[k] * b[k];
+    return sum;
+}
+
+
+__attribute__((target("sse2")))
+static void dot4_sse2(genann_real const *w0, genann_real const *w1, genann_real const *w2, genann_real const *w3,
+        genann_real const *x, int n, genann_real *out) {
+    V128 s0 = v128_zero(), s1 = v128_zero(), s2 = v128_zero(), s3 = v128_zero();
+    int k = 0;
+    for (; k + V128_LANES <= n; k += V128_LANES) {
+        const V128 xk = v128_load(x+k);
+        s0 = v128_add(s0, v128_mul(v128_load(w0+k), xk));
+        s1 = v128_add(s1, v128_mul(v128_load(w1+k), xk));
+        s2 = v128_add(s2, v128_mul(v128_load(w2+k), xk));
+        s3 = v128_add(s3, v128_mul(v128_load(w3+k), xk));
+    }
+    out[0] = v128_hsum(s0); out[1] = v128_hsum(s1); out[2] = v128_hsum(s2); out[3] = v128_hsum(s3);
+    for (; k < n; ++k) {
+        out[0] += w0[k] * x[k]; out[1] += w1[k] * x[k]; out[2] += w2[k] * x[k]; out[3] += w3[k] * x[k];
+    }
+}
+
+
+__attribute__((target("sse2")))
+static void axpy_sse2(genann_real alpha, genann_real const *x, genann_real *y, int n) {
+    const V128 a = v128_set1(alpha);
+    int k = 0;
+    for (; k + V128_LANES <= n; k += V128_LANES) {
+        v128_store(y+k, v128_add(v128_load(y+k), v128_mul(a, v128_load(x+k))));
+    }
+    for (; k < n; ++k) y[k] += alpha * x[k];
+}
+
+
+__attribute__((target("sse2")))
+static int dot_s8_sse2(signed char const *a, signed char const *b, int n) {
+    __m128i acc = _mm_setzero_si128();
+    int k = 0;
+    for (; k + 16 <= n; k += 16) {
+        const __m128i va = _mm_loadu_si128((__m128i const *)(a+k));
+        const __m128i vb = _mm_loadu_si128((__m128i const *)(b+k));
+        /* Sign extend to 16 bits by unpacking each byte into the high half and shifting down. */
+        const __m128i alo = _mm_srai_epi16(_mm_unpacklo_epi8(va, va), 8);
+        const __m128i ahi = _mm_srai_epi16(_mm_unpackhi_epi8(va, va), 8);
+        const __m128i blo = _mm_srai_epi16(_mm_unpacklo_epi8(vb, vb), 8);
+        const __m128i bhi = _mm_srai_epi16(_mm_unpackhi_epi8(vb, vb), 8);
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(alo, blo));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(ahi, bhi));
+    }
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+    int sum = _mm_cvtsi128_si32(acc);
+    for (; k < n; ++k) sum += a[k] * b[k];
+    return sum;
+}
+
+
+__attribute__((target("sse2")))
+static void momentum_sse2(genann_real *w, genann_real *v, genann_real const *g,
+        genann_real mu, genann_real rate, int nesterov, int n) {
+    const V128 vmu = v128_set1(mu), vrate = v128_set1(rate);
+    int k = 0;
+    for (; k + V128_LANES <= n; k += V128_LANES) {
+        const V128 step = v128_mul(vrate, v128_load(g+k));
+        const V128 vk = v128_add(v128_mul(vmu, v128_load(v+k)), step);
+        v128_store(v+k, vk);
+        v128_store(w+k, v128_add(v128_load(w+k), nesterov ? v128_add(v128_mul(vmu, vk), step) : vk));
+    }
+    momentum_scalar(w + k, v + k, g + k, mu, rate, nesterov, n - k);
+}
+
+
+__attribute__((target("sse2")))
+static void adam_sse2(genann_real *w, genann_real *m, genann_real *v, genann_real const *g,
+        genann_real b1, genann_real b2, genann_real rate, genann_real eps, int n) {
+    const V128 vb1 = v128_set1(b1), vc1 = v128_set1(1 - b1);
+    const V128 vb2 = v128_set1(b2), vc2 = v128_set1(1 - b2);
+    const V128 vrate = v128_set1(rate), veps = v128_set1(eps);
+    int k = 0;
+    for (; k + V128_LANES <= n; k += V128_LANES) {
+        const V128 gk = v128_load(g+k);
+        const V128 mk = v128_add(v128_mul(vb1, v128_load(m+k)), v128_mul(vc1, gk));
+        const V128 vk = v128_add(v128_mul(vb2, v128_load(v+k)), v128_mul(vc2, v128_mul(gk, gk)));
+        v128_store(m+k, mk);
+        v128_store(v+k, vk);
+        const V128 step = v128_div(v128_mul(vrate, mk), v128_add(v128_sqrt(vk), veps));
+        v128_store(w+k, v128_add(v128_load(w+k), step));
+    }
+    adam_scalar(w + k, m + k, v + k, g + k, b1, b2, rate, eps, n - k);
+}
+
+
+/* AVX2 with FMA, 256-bit registers. */
+
+__attribute__((target("avx2,fma")))
+static genann_real v256_hsum(V256 v) {
+#ifdef GENANN_FLOAT
+    return v128_hsum(_mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+#else
+    return v128_hsum(_mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1)));
+#endif
+}
+
+
+__attribute__((target("avx2,fma")))
+static genann_real dot_avx2(genann_real const *a, genann_real const *b, int n) {
+    V256 s0 = v256_zero(), s1 = v256_zero();
+    int k = 0;
+    for (; k + 2 * V256_LANES <= n; k += 2 * V256_LANES) {
+        s0 = v256_fmadd(v256_load(a+k), v256_load(b+k), s0);
+        s1 = v256_fmadd(v256_load(a+k+V256_LANES), v256_load(b+k+V256_LANES), s1);
+    }
+    if (k + V256_LANES <= n) {
+        s0 = v256_fmadd(v256_load(a+k), v256_load(b+k), s0);
+        k += V256_LANES;
+    }
+    genann_real sum = v256_hsum(v256_add(s0, s1));
+    for (; k < n; ++k) sum += a[k] * b[k];
+    return sum;
+}
+
+
+__attribute__((target("avx2,fma")))
+static void dot4_avx2(genann_real const *w0, genann_real const *w1, genann_real const *w2, genann_real const *w3,
+        genann_real const *x, int n, genann_real *out) {
+    V256 s0 = v256_zero(), s1 = v256_zero(), s2 = v256_zero(), s3 = v256_zero();
+    int k = 0;
+    for (; k + V256_LANES <= n; k += V256_LANES) {
+        const V256 xk = v256_load(x+k);
+        s0 = v256_fmadd(v256_load(w0+k), xk, s0);
+        s1 = v256_fmadd(v256_load(w1+k), xk, s1);
+        s2 = v256_fmadd(v256_load(w2+k), xk, s2);
+        s3 = v256_fmadd(v256_load(w3+k), xk, s3);
+    }
+    out[0] = v256_hsum(s0); out[1] = v256_hsum(s1); out[2] = v256_hsum(s2); out[3] = v256_hsum(s3);
+    for (; k < n; ++k) {
+        out[0] += w0[k] * x[k]; out[1] += w1[k] * x[k]; out[2] += w2[k] * x[k]; out[3] += w3[k] * x[k];
+    }
+}
+
+
+__attribute__((target("avx2,fma")))
+static void axpy_avx2(genann_real alpha, genann_real const *x, genann_real *y, int n) {
+    const V256 a = v256_set1(alpha);
+    int k = 0;
+    for (; k + V256_LANES <= n; k += V256_LANES) {
+        v256_store(y+k, v256_fmadd(a, v256_load(x+k), v256_load(y+k)));
+    }
+    for (; k < n; ++k) y[k] += alpha * x[k];
+}
+
+
+__attribute__((target("avx2,fma")))
+static int dot_s8_avx2(signed char const *a, signed char const *b, int n) {
+    __m256i acc = _mm256_setzero_si256();
+    int k = 0;
+    for (; k + 16 <= n; k += 16) {
+        const __m256i va = _mm256_cvtepi8_epi16(_mm_loadu_si128((__m128i const *)(a+k)));
+        const __m256i vb = _mm256_cvtepi8_epi16(_mm_loadu_si128((__m128i const *)(b+k)));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(va, vb));
+    }
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    int sum = _mm_cvtsi128_si32(s);
+    for (; k < n; ++k) sum += a[k] * b[k];
+    return sum;
+}
+
+
+__attribute__((target("avx2,fma")))
+static V256 v256_exp(V256 x) {
+    const V256 n = v256_round(v256_mul(x, v256_set1(LOG2E)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    V256 r = v256_fnmadd(n, v256_set1(LN2_HI), x);
+    r = v256_fnmadd(n, v256_set1(LN2_LO), r);
+
+    V256 p = v256_set1(exp_coef[0]);
+    int c;
+    for (c = 1; c <= EXP_DEGREE; ++c) {
+        p = v256_fmadd(p, r, v256_set1(exp_coef[c]));
+    }
+
+    /* Build 2^n directly in the exponent bits. */
+#ifdef GENANN_FLOAT
+    const __m256i e = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+    return _mm256_mul_ps(p, _mm256_castsi256_ps(e));
+#else
+    const __m256i e = _mm256_slli_epi64(_mm256_add_epi64(_mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(n)), _mm256_set1_epi64x(1023)), 52);
+    return _mm256_mul_pd(p, _mm256_castsi256_pd(e));
+#endif
+}
+
+
+__attribute__((target("avx2,fma")))
+static void sigmoid_avx2(genann_real *x, int n) {
+    const V256 zero = v256_zero(), one = v256_set1(1);
+    const V256 lo = v256_set1(-SIGMOID_LIMIT), hi = v256_set1(SIGMOID_LIMIT);
+    int k = 0;
+    for (; k + V256_LANES <= n; k += V256_LANES) {
+        const V256 v = v256_load(x+k);
+        const V256 c = v256_min(v256_max(v, lo), hi);
+        V256 y = v256_div(one, v256_add(one, v256_exp(v256_sub(zero, c))));
+        y = v256_blendv(y, zero, v256_cmp(v, lo, _CMP_LT_OQ));
+        y = v256_blendv(y, one, v256_cmp(v, hi, _CMP_GT_OQ));
+        /* The clamp turns NaN into lo; keep it NaN, as the scalar kernel does. */
+        y = v256_blendv(y, v, v256_cmp(v, v, _CMP_UNORD_Q));
+        v256_store(x+k, y);
+    }
+    sigmoid_scalar(x + k, n - k);
+}
+
+
+__attribute__((target("avx2,fma")))
+static void momentum_avx2(genann_real *w, genann_real *v, genann_real const *g,
+        genann_real mu, genann_real rate, int nesterov, int n) {
+    const V256 vmu = v256_set1(mu), vrate = v256_set1(rate);
+    int k = 0;
+    for (; k + V256_LANES <= n; k += V256_LANES) {
+        const V256 step = v256_mul(vrate, v256_load(g+k));
+        const V256 vk = v256_fmadd(vmu, v256_load(v+k), step);
+        v256_store(v+k, vk);
+        v256_store(w+k, v256_add(v256_load(w+k), nesterov ? v256_fmadd(vmu, vk, step) : vk));
+    }
+    momentum_scalar(w + k, v + k, g + k, mu, rate, nesterov, n - k);
+}
+
+
+__attribute__((target("avx2,fma")))
+static void adam_avx2(genann_real *w, genann_real *m, genann_real *v, genann_real const *g,
+        genann_real b1, genann_real b2, genann_real rate, genann_real eps, int n) {
+    const V256 vb1 = v256_set1(b1), vc1 = v256_set1(1 - b1);
+    const V256 vb2 = v256_set1(b2), vc2 = v256_set1(1 - b2);
+    const V256 vrate = v256_set1(rate), veps = v256_set1(eps);
+    int k = 0;
+    for (; k + V256_LANES <= n; k += V256_LANES) {
+        const V256 gk = v256_load(g+k);
+        const V256 mk = v256_fmadd(vb1, v256_load(m+k), v256_mul(vc1, gk));
+        const V256 vk = v256_fmadd(vb2, v256_load(v+k), v256_mul(vc2, v256_mul(gk, gk)));
+        v256_store(m+k, mk);
+        v256_store(v+k, vk);
+        const V256 step = v256_div(v256_mul(vrate, mk), v256_add(v256_sqrt(vk), veps));
+        v256_store(w+k, v256_add(v256_load(w+k), step));
+    }
+    adam_scalar(w + k, m + k, v + k, g + k, b1, b2, rate, eps, n - k);
+}
+
+
+/* AVX-512, 512-bit registers. Tails use masked loads instead of a scalar loop. */
+
+#define TAIL_MASK(rem) ((rem) >= V512_LANES ? (V512_MASK)~0u : (V512_MASK)((1u << (rem)) - 1))
+
+
+__attribute__((target("avx512f")))
+static genann_real dot_avx512(genann_real const *a, genann_real const *b, int n) {
+    V512 s0 = v512_zero(), s1 = v512_zero();
+    int k = 0;
+    for (; k + 2 * V512_LANES <= n; k += 2 * V512_LANES) {
+        s0 = v512_fmadd(v512_load(a+k), v512_load(b+k), s0);
+        s1 = v512_fmadd(v512_load(a+k+V512_LANES), v512_load(b+k+V512_LANES), s1);
+    }
+    for (; k < n; k += V512_LANES) {
+        const V512_MASK m = TAIL_MASK(n - k);
+        s0 = v512_fmadd(v512_maskz_load(m, a+k), v512_maskz_load(m, b+k), s0);
+    }
+    return v512_hsum(v512_add(s0, s1));
+}
+
+
+__attribute__((target("avx512f")))
+static void dot4_avx512(genann_real const *w0, genann_real const *w1, genann_real const *w2, genann_real const *w3,
+        genann_real const *x, int n, genann_real *out) {
+    V512 s0 = v512_zero(), s1 = v512_zero(), s2 = v512_zero(), s3 = v512_zero();
+    int k;
+    for (k = 0; k < n; k += V512_LANES) {
+        const V512_MASK m = TAIL_MASK(n - k);
+        const V512 xk = v512_maskz_load(m, x+k);
+        s0 = v512_fmadd(v512_maskz_load(m, w0+k), xk, s0);
+        s1 = v512_fmadd(v512_maskz_load(m, w1+k), xk, s1);
+        s2 = v512_fmadd(v512_maskz_load(m, w2+k), xk, s2);
+        s3 = v512_fmadd(v512_maskz_load(m, w3+k), xk, s3);
+    }
+    out[0] = v512_hsum(s0);
+    out[1] = v512_hsum(s1);
+    out[2] = v512_hsum(s2);
+    out[3] = v512_hsum(s3);
+}
+
+
+__attribute__((target("avx512f")))
+static void axpy_avx512(genann_real alpha, genann_real const *x, genann_real *y, int n) {
+    const V512 a = v512_set1(alpha);
+    int k;
+    for (k = 0; k < n; k += V512_LANES) {
+        const V512_MASK m = TAIL_MASK(n - k);
+        v512_mask_store(y+k, m, v512_fmadd(a, v512_maskz_load(m, x+k), v512_maskz_load(m, y+k)));
+    }
+}
+
+
+__attribute__((target("avx512f,avx512bw")))
+static int dot_s8_avx512(signed char const *a, signed char const *b, int n) {
+    __m512i acc = _mm512_setzero_si512();
+    int k = 0;
+    for (; k + 32 <= n; k += 32) {
+        const __m512i va = _mm512_cvtepi8_epi16(_mm256_loadu_si256((__m256i const *)(a+k)));
+        const __m512i vb = _mm512_cvtepi8_epi16(_mm256_loadu_si256((__m256i const *)(b+k)));
+        acc = _mm512_add_epi32(acc, _mm512_madd_epi16(va, vb));
+    }
+    int sum = _mm512_reduce_add_epi32(acc);
+    for (; k < n; ++k) sum += a[k] * b[k];
+    return sum;
+}
+
+
+__attribute__((target("avx512f")))
+static V512 v512_exp(V512 x) {
+    const V512 n = v512_roundscale(v512_mul(x, v512_set1(LOG2E)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    V512 r = v512_fnmadd(n, v512_set1(LN2_HI), x);
+    r = v512_fnmadd(n, v512_set1(LN2_LO), r);
+
+    V512 p = v512_set1(exp_coef[0]);
+    int c;
+    for (c = 1; c <= EXP_DEGREE; ++c) {
+        p = v512_fmadd(p, r, v512_set1(exp_coef[c]));
+    }
+
+    return v512_scalef(p, n);
+}
+
+
+__attribute__((target("avx512f")))
+static void sigmoid_avx512(genann_real *x, int n) {
+    const V512 zero = v512_zero(), one = v512_set1(1);
+    const V512 lo = v512_set1(-SIGMOID_LIMIT), hi = v512_set1(SIGMOID_LIMIT);
+    int k;
+    for (k = 0; k < n; k += V512_LANES) {
+        const V512_MASK m = TAIL_MASK(n - k);
+        const V512 v = v512_maskz_load(m, x+k);
+        const V512 c = v512_min(v512_max(v, lo), hi);
+        V512 y = v512_div(one, v512_add(one, v512_exp(v512_sub(zero, c))));
+        y = v512_mask_blend(v512_cmp_mask(v, lo, _CMP_LT_OQ), y, zero);
+        y = v512_mask_blend(v512_cmp_mask(v, hi, _CMP_GT_OQ), y, one);
+        y = v512_mask_blend(v512_cmp_mask(v, v, _CMP_UNORD_Q), y, v);
+        v512_mask_store(x+k, m, y);
+    }
+}
+
+
+__attribute__((target("avx512f")))
+static void momentum_avx512(genann_real *w, genann_real *v, genann_real const *g,
+        genann_real mu, genann_real rate, int nesterov, int n) {
+    const V512 vmu = v512_set1(mu), vrate = v512_set1(rate);
+    int k;
+    for (k = 0; k < n; k += V512_LANES) {
+        const V512_MASK m = TAIL_MASK(n - k);
+        const V512 step = v512_mul(vrate, v512_maskz_load(m, g+k));
+        const V512 vk = v512_fmadd(vmu, v512_maskz_load(m, v+k), step);
+        v512_mask_store(v+k, m, vk);
+        v512_mask_store(w+k, m, v512_add(v512_maskz_load(m, w+k), nesterov ? v512_fmadd(vmu, vk, step) : vk));
+    }
+}
+
+
+__attribute__((target("avx512f")))
+static void adam_avx512(genann_real *w, genann_real *m, genann_real *v, genann_real const *g,
+        genann_real b1, genann_real b2, genann_real rate, genann_real eps, int n) {
+    const V512 vb1 = v512_set1(b1), vc1 = v512_set1(1 - b1);
+    const V512 vb2 = v512_set1(b2), vc2 = v512_set1(1 - b2);
+    const V512 vrate = v512_set1(rate), veps = v512_set1(eps);
+    int k;
+    for (k = 0; k < n; k += V512_LANES) {
+        const V512_MASK t = TAIL_MASK(n - k);
+        const V512 gk = v512_maskz_load(t, g+k);
+        const V512 mk = v512_fmadd(vb1, v512_maskz_load(t, m+k), v512_mul(vc1, gk));
+        const V512 vk = v512_fmadd(vb2, v512_maskz_load(t, v+k), v512_mul(vc2, v512_mul(gk, gk)));
+        v512_mask_store(m+k, t, mk);
+        v512_mask_store(v+k, t, vk);
+        const V512 step = v512_div(v512_mul(vrate, mk), v512_add(v512_sqrt(vk), veps));
+        v512_mask_store(w+k, t, v512_add(v512_maskz_load(t, w+k), step));
+    }
+}
+
+#endif /* GENANN_SIMD_X86 */
+
+
+genann_kernels genann_kern = {dot_scalar, dot4_scalar, axpy_scalar, dot_s8_scalar, sigmoid_scalar,
+    momentum_scalar, adam_scalar};
+
+static int current_level = GENANN_SIMD_SCALAR;
+
+
+int genann_simd_detect(void) {
+#ifdef GENANN_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) return GENANN_SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return GENANN_SIMD_AVX2;
+    if (__builtin_cpu_supports("sse2")) return GENANN_SIMD_SSE2;
+#endif
+    return GENANN_SIMD_SCALAR;
+}
+
+
+int genann_simd_level(void) {
+    return current_level;
+}
+
+
+int genann_simd_select(int level) {
+    const int best = genann_simd_detect();
+    if (level > best) level = best;
+    if (level < GENANN_SIMD_SCALAR) level = GENANN_SIMD_SCALAR;
+
+    genann_kernels k = {dot_scalar, dot4_scalar, axpy_scalar, dot_s8_scalar, sigmoid_scalar,
+        momentum_scalar, adam_scalar};
+
+#ifdef GENANN_SIMD_X86
+    switch (level) {
+        case GENANN_SIMD_AVX512: k.dot = dot_avx512; k.dot4 = dot4_avx512; k.axpy = axpy_avx512; k.dot_s8 = dot_s8_avx512; k.sigmoid = sigmoid_avx512;
+            k.momentum = momentum_avx512; k.adam = adam_avx512; break;
+        case GENANN_SIMD_AVX2: k.dot = dot_avx2; k.dot4 = dot4_avx2; k.axpy = axpy_avx2; k.dot_s8 = dot_s8_avx2; k.sigmoid = sigmoid_avx2;
+            k.momentum = momentum_avx2; k.adam = adam_avx2; break;
+        case GENANN_SIMD_SSE2: k.dot = dot_sse2; k.dot4 = dot4_sse2; k.axpy = axpy_sse2; k.dot_s8 = dot_s8_sse2;
+            k.momentum = momentum_sse2; k.adam = adam_sse2; break;
+        default: break;
+    }
+#endif
+
+    genann_kern = k;
+    current_level = level;
+    return level;
+}
+
+
+#ifdef GENANN_SIMD_X86
+/* Pick the best kernels before main runs, so no caller ever races on the selection. */
+__attribute__((constructor))
+static void genann_simd_startup(void) {
+    genann_simd_select(GENANN_SIMD_AVX512);
+}
+#endif
@@ -0,0 +1,94 @@
+/*
+ * GENANN - Minimal C Artificial Neural Network
+ *
+ * Copyright (c) 2015, 2016 Lewis Van Winkle
+ *
+ * http://CodePlea.com
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgement in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ */
+
+
+#ifndef __GENANN_SIMD_H__
+#define __GENANN_SIMD_H__
+
+#include "genann.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Instruction set levels, in increasing order. */
+#define GENANN_SIMD_SCALAR 0
+#define GENANN_SIMD_SSE2 1
+#define GENANN_SIMD_AVX2 2
+#define GENANN_SIMD_AVX512 3
+
+
+typedef struct genann_kernels {
+    /* Returns sum of a[k] * b[k]. */
+    genann_real (*dot)(genann_real const *a, genann_real const *b, int n);
+
+    /* Four dot products of rows w0..w3 with the same x, written to out[0..3]. */
+    void (*dot4)(genann_real const *w0, genann_real const *w1, genann_real const *w2, genann_real const *w3,
+            genann_real const *x, int n, genann_real *out);
+
+    /* y[k] += alpha * x[k]. */
+    void (*axpy)(genann_real alpha, genann_real const *x, genann_real *y, int n);
+
+    /* Returns sum of a[k] * b[k] over signed bytes, accumulated in 32 bits. */
+    int (*dot_s8)(signed char const *a, signed char const *b, int n);
+
+    /* x[k] = genann_act_sigmoid(x[k]), in place. */
+    void (*sigmoid)(genann_real *x, int n);
+
+    /* Momentum step: v[k] = mu * v[k] + rate * g[k], then w[k] += v[k], or
+     * with nesterov set w[k] += mu * v[k] + rate * g[k]. */
+    void (*momentum)(genann_real *w, genann_real *v, genann_real const *g,
+            genann_real mu, genann_real rate, int nesterov, int n);
+
+    /* Adam step: m[k] = b1 * m[k] + (1 - b1) * g[k],
+     * v[k] = b2 * v[k] + (1 - b2) * g[k]^2, then
+     * w[k] += rate * m[k] / (sqrt(v[k]) + eps). */
+    void (*adam)(genann_real *w, genann_real *m, genann_real *v, genann_real const *g,
+            genann_real b1, genann_real b2, genann_real rate, genann_real eps, int n);
+} genann_kernels;
+
+
+/* Kernels in use. Set to the best level the CPU supports at startup. */
+extern genann_kernels genann_kern;
+
+
+/* Returns the best level this CPU supports. */
+int genann_simd_detect(void);
+
+/* Returns the level currently in use. */
+int genann_simd_level(void);
+
+/* Switches to the given level, clamped to what the CPU supports.
+ * GENANN_SIMD_SCALAR selects the reference loops. Returns the level selected.
+ * Not thread safe; call before starting any threads that run anns. */
+int genann_simd_select(int level);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*__GENANN_SIMD_H__*/
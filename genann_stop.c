@@ -0,0 +1,95 @@
+/*
+ * GENANN - Minimal C Artificial Neural Network
+ *
+ * Copyright (c) 2015, 2016 Lewis Van Winkle
+ *
+ * http://CodePlea.com
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgement in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ */
+
+
+#include "genann_stop.h"
+
+#include <stdlib.h>
+#include <math.h>
+
+
+genann_stop *genann_stop_init(int patience, double min_delta) {
+    if (patience < 1) return 0;
+
+    genann_stop *ret = malloc(sizeof(genann_stop));
+    if (!ret) return 0;
+
+    ret->patience = patience;
+    ret->min_delta = min_delta < 0 ? 0 : min_delta;
+    ret->epoch = 0;
+    ret->best_epoch = 0;
+    ret->best_loss = 0;
+    ret->best = 0;
+
+    return ret;
+}
+
+
+int genann_stop_update(genann_stop *stop, genann const *ann, double loss) {
+    ++stop->epoch;
+
+    /* A failed loss (genann_loss returns -1) or a diverged one can never be
+     * the best; it would only become a baseline nothing improves on. */
+    if (loss < 0 || isnan(loss)) return 1;
+
+    if (stop->best_epoch == 0 || loss < stop->best_loss - stop->min_delta) {
+        stop->best_epoch = stop->epoch;
+        stop->best_loss = loss;
+
+        if (ann) {
+            /* Only the weights are kept; the first snapshot allocates, later
+             * ones copy in place. */
+            if (stop->best && genann_copy_into(stop->best, ann) != 0) {
+                genann_free(stop->best);
+                stop->best = 0;
+            }
+            if (!stop->best) {
+                stop->best = genann_freeze(ann);
+                if (!stop->best) return -1;
+            }
+        }
+        return 0;
+    }
+
+    return stop->epoch - stop->best_epoch >= stop->patience;
+}
+
+
+int genann_stop_improved(genann_stop const *stop) {
+    return stop->epoch > 0 && stop->best_epoch == stop->epoch;
+}
+
+
+int genann_stop_restore(genann_stop const *stop, genann *ann) {
+    if (!stop->best) return -1;
+    return genann_copy_into(ann, stop->best);
+}
+
+
+void genann_stop_free(genann_stop *stop) {
+    if (!stop) return;
+    genann_free(stop->best);
+    free(stop);
+}
@@ -0,0 +1,87 @@
+/*
+ * GENANN - Minimal C Artificial Neural Network
+ *
+ * Copyright (c) 2015, 2016 Lewis Van Winkle
+ *
+ * http://CodePlea.com
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgement in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ */
+
+
+#ifndef __GENANN_STOP_H__
+#define __GENANN_STOP_H__
+
+#include "genann.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Early stopping on a validation loss. After every epoch the caller reports
+ * the loss on held-out data; the best weights seen so far are kept in a
+ * frozen snapshot, and training stops once the loss has not improved for
+ * patience epochs. */
+typedef struct genann_stop {
+    /* Epochs without improvement before stopping. */
+    int patience;
+
+    /* Smallest decrease of the loss that counts as an improvement. */
+    double min_delta;
+
+    /* Epochs reported so far, and the one with the lowest loss (0 if none). */
+    int epoch;
+    int best_epoch;
+    double best_loss;
+
+    /* Weights at best_epoch, allocated on the first improvement. Null if
+     * genann_stop_update was never given an ann. */
+    genann *best;
+
+} genann_stop;
+
+
+/* Creates a controller that stops after patience epochs without the loss
+ * dropping by more than min_delta. */
+genann_stop *genann_stop_init(int patience, double min_delta);
+
+/* Reports the validation loss of the epoch just trained. On an improvement
+ * ann's weights are copied to the snapshot; pass a null ann to only track
+ * the loss and keep the weights elsewhere. Returns 1 when training should
+ * stop, 0 to go on, -1 if the snapshot could not be allocated. A negative or
+ * NaN loss, e.g. from a failed genann_loss, stops at once and leaves the
+ * best epoch and snapshot as they were. */
+int genann_stop_update(genann_stop *stop, genann const *ann, double loss);
+
+/* Returns 1 if the last genann_stop_update was an improvement. */
+int genann_stop_improved(genann_stop const *stop);
+
+/* Copies the best weights back into ann. Returns 0 on success, -1 if there
+ * is no snapshot or ann has a different topology. */
+int genann_stop_restore(genann_stop const *stop, genann *ann);
+
+/* Frees the controller and its snapshot. */
+void genann_stop_free(genann_stop *stop);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*__GENANN_STOP_H__*/
@@ -0,0 +1,165 @@
+/*
+ * GENANN - Minimal C Artificial Neural Network
+ *
+ * Copyright (c) 2015, 2016 Lewis Van Winkle
+ *
+ * http://CodePlea.com
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgement in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ */
+
+
+#include "genann_threads.h"
+
+#include <stdlib.h>
+#include <pthread.h>
+
+
+struct genann_threads {
+    int count;
+    pthread_t *thread;
+
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+
+    /* Current task. A new task is signalled by bumping generation. */
+    genann_task task;
+    void *ctx;
+    unsigned generation;
+
+    /* Workers still running the current task. */
+    int pending;
+
+    /* Indices handed out to workers as they start. */
+    int started;
+
+    int quit;
+};
+
+
+static void *genann_threads_worker(void *arg) {
+    genann_threads *t = arg;
+
+    pthread_mutex_lock(&t->lock);
+    const int index = ++t->started;
+    unsigned seen = 0;
+
+    for (;;) {
+        while (t->generation == seen && !t->quit) {
+            pthread_cond_wait(&t->start, &t->lock);
+        }
+        if (t->quit) break;
+
+        seen = t->generation;
+        const genann_task task = t->task;
+        void *ctx = t->ctx;
+        pthread_mutex_unlock(&t->lock);
+
+        task(ctx, index, t->count);
+
+        pthread_mutex_lock(&t->lock);
+        if (--t->pending == 0) {
+            pthread_cond_signal(&t->done);
+        }
+    }
+
+    pthread_mutex_unlock(&t->lock);
+    return 0;
+}
+
+
+genann_threads *genann_threads_create(int count) {
+    if (count < 1) return 0;
+
+    genann_threads *t = calloc(1, sizeof(genann_threads));
+    if (!t) return 0;
+
+    t->thread = malloc(sizeof(pthread_t) * count);
+    if (!t->thread) {
+        free(t);
+        return 0;
+    }
+
+    pthread_mutex_init(&t->lock, 0);
+    pthread_cond_init(&t->start, 0);
+    pthread_cond_init(&t->done, 0);
+
+    /* The caller is thread 0, so start one fewer. */
+    t->count = 1;
+    int i;
+    for (i = 1; i < count; ++i) {
+        if (pthread_create(t->thread + i, 0, genann_threads_worker, t) != 0) {
+            genann_threads_free(t);
+            return 0;
+        }
+        t->count = i + 1;
+    }
+
+    return t;
+}
+
+
+int genann_threads_count(genann_threads const *threads) {
+    return threads->count;
+}
+
+
+void genann_threads_run(genann_threads *t, genann_task task, void *ctx) {
+    if (t->count == 1) {
+        task(ctx, 0, 1);
+        return;
+    }
+
+    pthread_mutex_lock(&t->lock);
+    t->task = task;
+    t->ctx = ctx;
+    t->pending = t->count - 1;
+    ++t->generation;
+    pthread_cond_broadcast(&t->start);
+    pthread_mutex_unlock(&t->lock);
+
+    task(ctx, 0, t->count);
+
+    pthread_mutex_lock(&t->lock);
+    while (t->pending > 0) {
+        pthread_cond_wait(&t->done, &t->lock);
+    }
+    pthread_mutex_unlock(&t->lock);
+}
+
+
+void genann_threads_free(genann_threads *t) {
+    if (!t) return;
+
+    pthread_mutex_lock(&t->lock);
+    t->quit = 1;
+    pthread_cond_broadcast(&t->start);
+    pthread_mutex_unlock(&t->lock);
+
+    int i;
+    for (i = 1; i < t->count; ++i) {
+        pthread_join(t->thread[i], 0);
+    }
+
+    pthread_cond_destroy(&t->done);
+    pthread_cond_destroy(&t->start);
+    pthread_mutex_destroy(&t->lock);
+    free(t->thread);
+    free(t);
+}
@@ -0,0 +1,60 @@
+/*
+ * GENANN - Minimal C Artificial Neural Network
+ *
+ * Copyright (c) 2015, 2016 Lewis Van Winkle
+ *
+ * http://CodePlea.com
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgement in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ */
+
+
+#ifndef __GENANN_THREADS_H__
+#define __GENANN_THREADS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* A fixed set of worker threads that all run the same task, then wait for the next one. */
+typedef struct genann_threads genann_threads;
+
+/* Task run by every thread. index is 0..count-1; index 0 is the calling thread. */
+typedef void (*genann_task)(void *ctx, int index, int count);
+
+
+/* Creates count - 1 worker threads; the caller of genann_threads_run is the last one.
+ * Returns 0 on failure. */
+genann_threads *genann_threads_create(int count);
+
+/* Number of threads, including the caller. */
+int genann_threads_count(genann_threads const *threads);
+
+/* Runs task on every thread and returns once all of them have finished. */
+void genann_threads_run(genann_threads *threads, genann_task task, void *ctx);
+
+/* Stops and joins the workers. */
+void genann_threads_free(genann_threads *threads);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*__GENANN_THREADS_H__*/